@@ -1,10 +1,15 @@
+#include <pthread.h>
+#include <setjmp.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 
+typedef uint8_t  u8;
 typedef uint32_t u32;
+typedef uint64_t u64;
 typedef int32_t  i32;
 typedef int64_t  i64;
 
@@ -12,8 +17,28 @@ typedef int64_t  i64;
 #define ERROR 1
 
 #define CAP_NODES  (1 << 7)
-#define CAP_VARS   (1 << 6)
+#define CAP_SLOTS  (1 << 6)
 #define CAP_SCOPES (1 << 6)
+#define CAP_NAMES  (1 << 4)
+#define CAP_CODE   (1 << 8)
+#define CAP_STACK  (1 << 6)
+#define CAP_FRAMES (1 << 6)
+#define CAP_KONTS  (1 << 6)
+#define CAP_ROOTS  (1 << 3)
+#define CAP_JIT    (1 << 12)
+#define CAP_FACTS  ((CAP_NODES + 1) * CAP_NAMES)
+#define CAP_PATHS  (1 << 6)
+#define CAP_SOURCE  (1 << 12)
+#define CAP_TOKENS  (1 << 8)
+#define CAP_SYMBOLS (1 << 6)
+#define CAP_TABLE   (1 << 7)
+
+#define CAP_WORKERS (1 << 3)
+#define CAP_QUEUE   (1 << 4)
+
+#define NANO_PER_SECOND 1000000000llu
+
+#define JIT_THRESHOLD 2
 
 #define EXIT()                                              \
     {                                                       \
@@ -27,11 +52,29 @@ typedef int64_t  i64;
         _exit(ERROR);                                                        \
     }
 
+#define FAIL()                                              \
+    {                                                       \
+        printf("%s:%s:%d\n", __FILE__, __func__, __LINE__); \
+        if (memory->bail) {                                 \
+            longjmp(*memory->bail, 1);                      \
+        }                                                   \
+        _exit(ERROR);                                       \
+    }
+
+#define FAIL_IF(condition)                                                   \
+    if (condition) {                                                         \
+        printf("%s:%s:%d `%s`\n", __FILE__, __func__, __LINE__, #condition); \
+        if (memory->bail) {                                                  \
+            longjmp(*memory->bail, 1);                                       \
+        }                                                                    \
+        _exit(ERROR);                                                        \
+    }
+
 #if 0
     #define TRACE(expr)                                  \
         {                                                \
             printf("\n%s:%d\n    ", __func__, __LINE__); \
-            print_expr(expr);                            \
+            print_expr(memory, expr);                    \
             printf("\n");                                \
         }
 #else
@@ -56,8 +99,8 @@ typedef struct {
     })
 
 typedef union {
-    String as_string;
-    i64    as_i64;
+    u32 as_symbol;
+    i64 as_i64;
 } TokenBody;
 
 typedef enum {
@@ -83,8 +126,24 @@ typedef struct {
 typedef struct AstExpr AstExpr;
 
 typedef struct {
-    String         label;
+    u32 depth;
+    u32 slot;
+} Address;
+
+typedef struct {
+    u32     symbol;
+    Address address;
+} AstIdent;
+
+typedef struct {
+    const AstExpr* expr;
+    u32            len_slots;
+} AstFn0;
+
+typedef struct {
+    u32            symbol;
     const AstExpr* expr;
+    u32            len_slots;
 } AstFn1;
 
 typedef enum {
@@ -101,9 +160,9 @@ typedef struct {
 
 typedef union {
     const AstExpr* as_exprs[2];
-    const AstExpr* as_fn0;
+    AstFn0         as_fn0;
     AstFn1         as_fn1;
-    String         as_string;
+    AstIdent       as_ident;
     i64            as_i64;
     Intrinsic      as_intrinsic;
 } AstExprBody;
@@ -123,34 +182,239 @@ struct AstExpr {
     AstExprTag  tag;
 };
 
-typedef struct Var   Var;
+typedef enum {
+    STATUS_OK = 0,
+    STATUS_LEX,
+    STATUS_PARSE,
+    STATUS_RESOLVE,
+    STATUS_EVAL,
+} Status;
+
 typedef struct Scope Scope;
 
+enum {
+    ENV_LITERAL_TAG = 1,
+    ENV_LITERAL_SHIFT = 1,
+};
+
+#define LITERAL_MAX (INT64_MAX >> ENV_LITERAL_SHIFT)
+#define LITERAL_MIN (-LITERAL_MAX - 1)
+
+// NOTE: Integers are carried unboxed, tagged in the low bit of the pointer.
 typedef struct {
-    Scope*         scope;
-    const AstExpr* expr;
+    Scope* scope;
+    union {
+        const AstExpr* expr;
+        u64            bits;
+    };
 } Env;
 
-struct Var {
-    String label;
-    Env    env;
-    Var*   next;
-};
-
 struct Scope {
-    Var*   vars;
+    Env*   slots;
     Scope* next;
+    Scope* forward;
+    u32    len_slots;
+};
+
+typedef struct {
+    u32 symbol;
+    u32 frame;
+    u32 slot;
+} Target;
+
+typedef union {
+    i64    as_i64;
+    Target as_alias;
+} FactBody;
+
+typedef enum {
+    FACT_NONE = 0,
+    FACT_I64,
+    FACT_ALIAS,
+} FactTag;
+
+typedef struct {
+    FactBody body;
+    u32      stores;
+    u32      loads;
+    Bool     defined;
+    Bool     pure;
+    FactTag  tag;
+} Fact;
+
+typedef struct Lexical Lexical;
+
+struct Lexical {
+    u32            frame;
+    const Lexical* parent;
+};
+
+typedef struct Names Names;
+
+// NOTE: Only the first `visible` names of `parent` can be assigned to from
+// inside this frame.
+struct Names {
+    u32          symbols[CAP_NAMES];
+    u32          len;
+    u32          visible;
+    const Names* parent;
 };
 
 typedef struct {
-    AstExpr nodes[CAP_NODES];
-    u32     len_nodes;
-    Var     vars[CAP_VARS];
-    u32     len_vars;
-    Scope   scopes[CAP_SCOPES];
-    u32     len_scopes;
+    const AstExpr* fn;
+    u32            visible;
+} Pending;
+
+typedef enum {
+    OP_PUSH = 0,
+    OP_LOAD,
+    OP_STORE,
+    OP_DROP,
+    OP_ADD,
+    OP_MUL,
+    OP_CALL,
+    OP_RET,
+    OP_VOID,
+    OP_HALT,
+} OpTag;
+
+typedef struct {
+    u32   node;
+    OpTag tag;
+} Op;
+
+typedef struct {
+    Scope* scope;
+    u32    pc;
+} Frame;
+
+typedef enum {
+    KONT_APPLY = 0,
+    KONT_SEMICOLON,
+    KONT_ASSIGN,
+    KONT_ADD_LEFT,
+    KONT_ADD_RIGHT,
+    KONT_MUL_LEFT,
+    KONT_MUL_RIGHT,
+    KONT_PROFILE,
+} KontTag;
+
+typedef struct {
+    Env     env;
+    KontTag tag;
+} Kont;
+
+typedef struct timespec Time;
+
+typedef struct {
+    u64 count;
+    u64 allocs;
+    u64 nanos;
+} Profile;
+
+typedef struct {
+    u64 start;
+    u64 allocs;
+    u32 node;
+    u32 path;
+} Sample;
+
+typedef struct {
+    u64 nanos;
+    u32 node;
+    u32 parent;
+} Path;
+
+typedef struct {
+    char     source[CAP_SOURCE];
+    u32      len_source;
+    Token    tokens[CAP_TOKENS];
+    u32      len_tokens;
+    String   symbols[CAP_SYMBOLS];
+    u32      len_symbols;
+    u32      table[CAP_TABLE];
+    AstExpr  nodes[CAP_NODES];
+    u32      len_nodes;
+    Env      slots[CAP_SLOTS * 2];
+    Env*     from_slots;
+    Env*     to_slots;
+    u32      len_slots;
+    Scope    scopes[CAP_SCOPES * 2];
+    Scope*   from_scopes;
+    Scope*   to_scopes;
+    u32      len_scopes;
+    Scope**  roots[CAP_ROOTS];
+    u32      len_roots;
+    Op       code[CAP_CODE];
+    u32      len_code;
+    u32      entries[CAP_NODES];
+    Env      stack[CAP_STACK];
+    u32      len_stack;
+    Frame    frames[CAP_FRAMES];
+    u32      len_frames;
+    Kont     konts[CAP_KONTS];
+    u32      len_konts;
+    u32      calls[CAP_NODES];
+    u32      natives[CAP_NODES];
+    u8*      jit;
+    u32      len_jit;
+    Fact     facts[CAP_FACTS];
+    Profile  profiles[CAP_NODES];
+    Sample   samples[CAP_KONTS];
+    u32      len_samples;
+    Path     paths[CAP_PATHS];
+    u32      len_paths;
+    u32      path;
+    u64      len_allocs;
+    Bool     profiling;
+    jmp_buf* bail;
+    Status   stage;
 } Memory;
 
+typedef i64 (*JitFn)(i64*);
+
+#define NATIVE_NONE 0xFFFFFFFF
+#define NATIVE_SKIP 0xFFFFFFFE
+
+#define NATIVE_OVERFLOW INT64_MIN
+
+static void reset_memory(Memory* memory) {
+    memory->len_source = 0;
+    memory->len_tokens = 0;
+    memory->len_symbols = 0;
+    for (u32 i = 0; i < CAP_TABLE; ++i) {
+        memory->table[i] = 0;
+    }
+    memory->len_nodes = 0;
+    memory->from_slots = &memory->slots[0];
+    memory->to_slots = &memory->slots[CAP_SLOTS];
+    memory->len_slots = 0;
+    memory->from_scopes = &memory->scopes[0];
+    memory->to_scopes = &memory->scopes[CAP_SCOPES];
+    memory->len_scopes = 0;
+    memory->len_roots = 0;
+    memory->len_code = 0;
+    memory->len_stack = 0;
+    memory->len_frames = 0;
+    memory->len_konts = 0;
+    for (u32 i = 0; i < CAP_NODES; ++i) {
+        memory->calls[i] = 0;
+        memory->natives[i] = NATIVE_NONE;
+    }
+    memory->len_jit = 0;
+    for (u32 i = 0; i < CAP_NODES; ++i) {
+        memory->profiles[i] = (Profile){0};
+    }
+    memory->len_samples = 0;
+    memory->paths[0] = (Path){0};
+    memory->len_paths = 1;
+    memory->path = 0;
+    memory->len_allocs = 0;
+    memory->profiling = FALSE;
+    memory->bail = NULL;
+    memory->stage = STATUS_OK;
+}
+
 static Memory* alloc_memory(void) {
     void* address = mmap(NULL,
                          sizeof(Memory),
@@ -160,21 +424,32 @@ static Memory* alloc_memory(void) {
                          0);
     EXIT_IF(address == MAP_FAILED);
     Memory* memory = (Memory*)address;
-    memory->len_nodes = 0;
-    memory->len_vars = 0;
-    memory->len_scopes = 0;
+    memory->jit = NULL;
+    reset_memory(memory);
     return memory;
 }
 
+static void free_memory(Memory* memory) {
+    if (memory->jit) {
+        EXIT_IF(munmap(memory->jit, CAP_JIT));
+    }
+    EXIT_IF(munmap(memory, sizeof(Memory)));
+}
+
 static AstExpr* alloc_expr(Memory* memory) {
-    EXIT_IF(CAP_NODES <= memory->len_nodes);
+    FAIL_IF(CAP_NODES <= memory->len_nodes);
     return &memory->nodes[memory->len_nodes++];
 }
 
-static const AstExpr* alloc_expr_ident(Memory* memory, String string) {
+static u32 get_node(Memory* memory, const AstExpr* expr) {
+    return (u32)(expr - memory->nodes);
+}
+
+static const AstExpr* alloc_expr_ident(Memory* memory, u32 symbol) {
     AstExpr* expr = alloc_expr(memory);
     expr->tag = AST_EXPR_IDENT;
-    expr->body.as_string = string;
+    expr->body.as_ident.symbol = symbol;
+    expr->body.as_ident.address = (Address){0};
     return expr;
 }
 
@@ -211,20 +486,108 @@ static const AstExpr* alloc_expr_intrinsic(Memory*        memory,
     return intrinsic;
 }
 
-static Var* alloc_var(Memory* memory) {
-    EXIT_IF(CAP_VARS <= memory->len_vars);
-    Var* var = &memory->vars[memory->len_vars++];
-    var->label = (String){0};
-    var->env = (Env){0};
-    var->next = NULL;
-    return var;
+static void push_root(Memory* memory, Scope** root) {
+    EXIT_IF(CAP_ROOTS <= memory->len_roots);
+    memory->roots[memory->len_roots++] = root;
+}
+
+static void pop_root(Memory* memory) {
+    EXIT_IF(memory->len_roots == 0);
+    --memory->len_roots;
+}
+
+static Scope* copy_scope(Memory* memory, Scope* old) {
+    if (!old) {
+        return NULL;
+    }
+    if (old->forward) {
+        return old->forward;
+    }
+    FAIL_IF(CAP_SCOPES <= memory->len_scopes);
+    FAIL_IF(CAP_SLOTS < (memory->len_slots + old->len_slots));
+    Scope* new = &memory->from_scopes[memory->len_scopes++];
+    new->slots = &memory->from_slots[memory->len_slots];
+    memcpy(new->slots, old->slots, old->len_slots * sizeof(Env));
+    memory->len_slots += old->len_slots;
+    new->next = old->next;
+    new->forward = NULL;
+    new->len_slots = old->len_slots;
+    old->forward = new;
+    return new;
+}
+
+// NOTE: Nodes are never collected; they are only allocated while parsing.
+static void collect(Memory* memory) {
+    {
+        Scope* swap = memory->from_scopes;
+        memory->from_scopes = memory->to_scopes;
+        memory->to_scopes = swap;
+    }
+    {
+        Env* swap = memory->from_slots;
+        memory->from_slots = memory->to_slots;
+        memory->to_slots = swap;
+    }
+    memory->len_scopes = 0;
+    memory->len_slots = 0;
+
+    for (u32 i = 0; i < memory->len_roots; ++i) {
+        *memory->roots[i] = copy_scope(memory, *memory->roots[i]);
+    }
+    for (u32 i = 0; i < memory->len_konts; ++i) {
+        memory->konts[i].env.scope =
+            copy_scope(memory, memory->konts[i].env.scope);
+    }
+    for (u32 i = 0; i < memory->len_stack; ++i) {
+        memory->stack[i].scope = copy_scope(memory, memory->stack[i].scope);
+    }
+    for (u32 i = 0; i < memory->len_frames; ++i) {
+        memory->frames[i].scope = copy_scope(memory, memory->frames[i].scope);
+    }
+
+    for (u32 i = 0; i < memory->len_scopes; ++i) {
+        Scope* scope = &memory->from_scopes[i];
+        scope->next = copy_scope(memory, scope->next);
+        for (u32 j = 0; j < scope->len_slots; ++j) {
+            scope->slots[j].scope = copy_scope(memory, scope->slots[j].scope);
+        }
+    }
 }
 
-static Scope* alloc_scope(Memory* memory) {
-    EXIT_IF(CAP_SCOPES <= memory->len_scopes);
-    Scope* scope = &memory->scopes[memory->len_scopes++];
-    scope->vars = NULL;
+static Scope* alloc_scope(Memory* memory, u32 len_slots) {
+    if ((CAP_SCOPES <= memory->len_scopes) ||
+        (CAP_SLOTS < (memory->len_slots + len_slots)))
+    {
+        collect(memory);
+    }
+    FAIL_IF(CAP_SCOPES <= memory->len_scopes);
+    FAIL_IF(CAP_SLOTS < (memory->len_slots + len_slots));
+    Scope* scope = &memory->from_scopes[memory->len_scopes++];
+    scope->slots = &memory->from_slots[memory->len_slots];
+    for (u32 i = 0; i < len_slots; ++i) {
+        scope->slots[i] = (Env){0};
+    }
+    memory->len_slots += len_slots;
+    ++memory->len_allocs;
     scope->next = NULL;
+    scope->forward = NULL;
+    scope->len_slots = len_slots;
+    return scope;
+}
+
+static Scope* push_call(Memory* memory, Env func, Env arg) {
+    u32 len_slots = func.expr->tag == AST_EXPR_FN0
+                        ? func.expr->body.as_fn0.len_slots
+                        : func.expr->body.as_fn1.len_slots;
+    push_root(memory, &func.scope);
+    push_root(memory, &arg.scope);
+    Scope* scope = alloc_scope(memory, len_slots);
+    pop_root(memory);
+    pop_root(memory);
+    scope->next = func.scope;
+    if (func.expr->tag == AST_EXPR_FN1) {
+        scope->slots[0] = arg;
+    }
     return scope;
 }
 
@@ -236,45 +599,58 @@ static void print_string(String string) {
     printf("%.*s", string.len, string.buffer);
 }
 
-static Var* lookup_var(Var* var, String label) {
-    while (var) {
-        if (eq(label, var->label)) {
-            return var;
-        }
-        var = var->next;
+static Env* get_slot(Scope* scope, Address address) {
+    for (u32 i = 0; i < address.depth; ++i) {
+        scope = scope->next;
     }
-    return NULL;
+    return &scope->slots[address.slot];
 }
 
-static Var* lookup_scope(const Scope* scope, String label) {
-    while (scope) {
-        Var* var = lookup_var(scope->vars, label);
-        if (var) {
-            return var;
-        }
-        scope = scope->next;
+static Env pack_i64(Scope* scope, i64 x) {
+    return (Env){
+        .scope = scope,
+        .bits = ((0x7FFFFFFFFFFFFFFFllu & (u64)x) << ENV_LITERAL_SHIFT) |
+                ENV_LITERAL_TAG,
+    };
+}
+
+static Bool is_i64(Env env) {
+    return (env.bits & ENV_LITERAL_TAG) == ENV_LITERAL_TAG;
+}
+
+// NOTE: Parameters are bound unevaluated, so an integer can still be a node.
+static i64 get_i64(Env env) {
+    if (is_i64(env)) {
+        return ((i64)env.bits) >> ENV_LITERAL_SHIFT;
     }
-    return NULL;
+    EXIT_IF((!env.expr) || (env.expr->tag != AST_EXPR_I64));
+    return env.expr->body.as_i64;
+}
+
+static i64 get_operand(Memory* memory, Env env) {
+    FAIL_IF((!is_i64(env)) &&
+            ((!env.expr) || (env.expr->tag != AST_EXPR_I64)));
+    return get_i64(env);
 }
 
-static void push_var(Memory* memory, Scope* scope, String label, Env env) {
-    Var* var = alloc_var(memory);
-    var->label = label;
-    var->env = env;
-    var->next = scope->vars;
-    scope->vars = var;
+static i64 add_i64(Memory* memory, i64 a, i64 b) {
+    i64 x;
+    FAIL_IF(__builtin_add_overflow(a, b, &x) || (x < LITERAL_MIN) ||
+            (LITERAL_MAX < x));
+    return x;
 }
 
-static Scope* push_scope(Memory* memory, Scope* parent) {
-    Scope* child = alloc_scope(memory);
-    child->next = parent;
-    return child;
+static i64 mul_i64(Memory* memory, i64 a, i64 b) {
+    i64 x;
+    FAIL_IF(__builtin_mul_overflow(a, b, &x) || (x < LITERAL_MIN) ||
+            (LITERAL_MAX < x));
+    return x;
 }
 
-static void print_token(Token token) {
+static void print_token(Memory* memory, Token token) {
     switch (token.tag) {
     case TOKEN_IDENT: {
-        print_string(token.body.as_string);
+        print_string(memory->symbols[token.body.as_symbol]);
         break;
     }
     case TOKEN_I64: {
@@ -324,9 +700,9 @@ static void print_token(Token token) {
     }
 }
 
-static void print_tokens(const Token* tokens) {
+static void print_tokens(Memory* memory, const Token* tokens) {
     for (u32 i = 0;;) {
-        print_token(tokens[i++]);
+        print_token(memory, tokens[i++]);
         if (tokens[i].tag == TOKEN_END) {
             putchar('\n');
             return;
@@ -335,27 +711,216 @@ static void print_tokens(const Token* tokens) {
     }
 }
 
+static u32 hash_string(String string) {
+    u64 hash = 2166136261;
+    for (u32 i = 0; i < string.len; ++i) {
+        hash = ((hash ^ (u8)string.buffer[i]) * 16777619) & 0xFFFFFFFF;
+    }
+    return (u32)hash;
+}
+
+static u32 intern(Memory* memory, String string) {
+    u32 hash = hash_string(string);
+    for (u32 i = 0; i < CAP_TABLE; ++i) {
+        u32* bucket = &memory->table[((u64)hash + i) % CAP_TABLE];
+        if (*bucket == 0) {
+            FAIL_IF(CAP_SYMBOLS <= memory->len_symbols);
+            memory->symbols[memory->len_symbols++] = string;
+            *bucket = memory->len_symbols;
+            return *bucket - 1;
+        }
+        if (eq(memory->symbols[*bucket - 1], string)) {
+            return *bucket - 1;
+        }
+    }
+    EXIT();
+}
+
+static u32 get_utf8_len(const u8* bytes, u32 len) {
+    u8  lead = bytes[0];
+    u8  min = 0x80;
+    u8  max = 0xBF;
+    u32 n;
+    if (lead < 0x80) {
+        return 1;
+    } else if (lead < 0xC2) {
+        return 0;
+    } else if (lead < 0xE0) {
+        n = 2;
+    } else if (lead < 0xF0) {
+        n = 3;
+        if (lead == 0xE0) {
+            min = 0xA0;
+        } else if (lead == 0xED) {
+            max = 0x9F;
+        }
+    } else if (lead < 0xF5) {
+        n = 4;
+        if (lead == 0xF0) {
+            min = 0x90;
+        } else if (lead == 0xF4) {
+            max = 0x8F;
+        }
+    } else {
+        return 0;
+    }
+    if ((len < n) || (bytes[1] < min) || (max < bytes[1])) {
+        return 0;
+    }
+    for (u32 i = 2; i < n; ++i) {
+        if ((bytes[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+    }
+    return n;
+}
+
+static Bool is_space(u8 byte) {
+    return (byte == ' ') || (byte == '\t') || (byte == '\n') ||
+           (byte == '\r');
+}
+
+static Bool is_digit(u8 byte) {
+    return ('0' <= byte) && (byte <= '9');
+}
+
+static Bool is_alpha(u8 byte) {
+    return (('a' <= byte) && (byte <= 'z')) ||
+           (('A' <= byte) && (byte <= 'Z')) || (byte == '_');
+}
+
+static Token lex_token(Memory* memory, String source, u32* i) {
+    const u8* bytes = (const u8*)source.buffer;
+    u32       start = *i;
+    switch (bytes[start]) {
+    case '(': {
+        ++(*i);
+        return (Token){.tag = TOKEN_LPAREN};
+    }
+    case ')': {
+        ++(*i);
+        return (Token){.tag = TOKEN_RPAREN};
+    }
+    case '\\': {
+        ++(*i);
+        return (Token){.tag = TOKEN_BACKSLASH};
+    }
+    case ';': {
+        ++(*i);
+        return (Token){.tag = TOKEN_SEMICOLON};
+    }
+    case '=': {
+        ++(*i);
+        return (Token){.tag = TOKEN_ASSIGN};
+    }
+    case '+': {
+        ++(*i);
+        return (Token){.tag = TOKEN_ADD};
+    }
+    case '*': {
+        ++(*i);
+        return (Token){.tag = TOKEN_MUL};
+    }
+    case '-': {
+        FAIL_IF((source.len <= (start + 1)) || (bytes[start + 1] != '>'));
+        *i += 2;
+        return (Token){.tag = TOKEN_ARROW};
+    }
+    default: {
+        break;
+    }
+    }
+    if (is_digit(bytes[start])) {
+        i64 x = 0;
+        for (; (*i < source.len) && is_digit(bytes[*i]); ++(*i)) {
+            i64 digit = bytes[*i] - '0';
+            FAIL_IF(((LITERAL_MAX - digit) / 10) < x);
+            x = (x * 10) + digit;
+        }
+        FAIL_IF((*i < source.len) && is_alpha(bytes[*i]));
+        return (Token){.body = {.as_i64 = x}, .tag = TOKEN_I64};
+    }
+    while (*i < source.len) {
+        if (is_alpha(bytes[*i]) || is_digit(bytes[*i])) {
+            ++(*i);
+            continue;
+        }
+        if (bytes[*i] < 0x80) {
+            break;
+        }
+        u32 len = get_utf8_len(&bytes[*i], source.len - *i);
+        FAIL_IF(len == 0);
+        *i += len;
+    }
+    FAIL_IF(*i == start);
+    String string = {.buffer = &source.buffer[start], .len = *i - start};
+    if (eq(string, STRING("_"))) {
+        return (Token){.tag = TOKEN_VOID};
+    }
+    return (Token){
+        .body = {.as_symbol = intern(memory, string)},
+        .tag = TOKEN_IDENT,
+    };
+}
+
+static const Token* lex(Memory* memory, String source) {
+    const Token* tokens = &memory->tokens[memory->len_tokens];
+    for (u32 i = 0;;) {
+        while ((i < source.len) && is_space((u8)source.buffer[i])) {
+            ++i;
+        }
+        FAIL_IF(CAP_TOKENS <= memory->len_tokens);
+        if (source.len <= i) {
+            memory->tokens[memory->len_tokens++] = (Token){.tag = TOKEN_END};
+            return tokens;
+        }
+        memory->tokens[memory->len_tokens++] = lex_token(memory, source, &i);
+    }
+}
+
+static String read_source(Memory* memory, const char* path) {
+    FILE* file = fopen(path, "rb");
+    EXIT_IF(!file);
+    EXIT_IF(fseek(file, 0, SEEK_END));
+    long size = ftell(file);
+    EXIT_IF((size < 0) || ((CAP_SOURCE - memory->len_source) < (u64)size));
+    rewind(file);
+    String source = {
+        .buffer = &memory->source[memory->len_source],
+        .len = (u32)size,
+    };
+    EXIT_IF(fread(&memory->source[memory->len_source],
+                  sizeof(char),
+                  source.len,
+                  file) != source.len);
+    EXIT_IF(fclose(file));
+    memory->len_source += source.len;
+    return source;
+}
+
 const AstExpr* parse_expr(Memory*, const Token**, u32, u32);
 
 static const AstExpr* parse_fn(Memory*       memory,
                                const Token** tokens,
                                u32           depth) {
     if ((*tokens)->tag != TOKEN_IDENT) {
-        EXIT_IF((*tokens)->tag != TOKEN_ARROW);
+        FAIL_IF((*tokens)->tag != TOKEN_ARROW);
         AstExpr* expr = alloc_expr(memory);
         expr->tag = AST_EXPR_FN0;
         ++(*tokens);
-        expr->body.as_fn0 = parse_expr(memory, tokens, 0, depth);
+        expr->body.as_fn0.expr = parse_expr(memory, tokens, 0, depth);
+        expr->body.as_fn0.len_slots = 0;
         return expr;
     }
-    EXIT_IF((*tokens)->tag != TOKEN_IDENT);
+    FAIL_IF((*tokens)->tag != TOKEN_IDENT);
     AstExpr* expr = alloc_expr(memory);
     expr->tag = AST_EXPR_FN1;
-    expr->body.as_fn1.label = (*tokens)->body.as_string;
+    expr->body.as_fn1.symbol = (*tokens)->body.as_symbol;
     ++(*tokens);
-    EXIT_IF((*tokens)->tag != TOKEN_ARROW);
+    FAIL_IF((*tokens)->tag != TOKEN_ARROW);
     ++(*tokens);
     expr->body.as_fn1.expr = parse_expr(memory, tokens, 0, depth);
+    expr->body.as_fn1.len_slots = 0;
     return expr;
 }
 
@@ -380,12 +945,12 @@ const AstExpr* parse_expr(Memory*       memory,
     case TOKEN_LPAREN: {
         ++(*tokens);
         expr = parse_expr(memory, tokens, 0, depth + 1);
-        EXIT_IF((*tokens)->tag != TOKEN_RPAREN);
+        FAIL_IF((*tokens)->tag != TOKEN_RPAREN);
         ++(*tokens);
         break;
     }
     case TOKEN_IDENT: {
-        expr = alloc_expr_ident(memory, (*tokens)->body.as_string);
+        expr = alloc_expr_ident(memory, (*tokens)->body.as_symbol);
         ++(*tokens);
         break;
     }
@@ -412,7 +977,7 @@ const AstExpr* parse_expr(Memory*       memory,
     case TOKEN_MUL:
     case TOKEN_END:
     default: {
-        EXIT();
+        FAIL();
     }
     }
     for (;;) {
@@ -442,7 +1007,7 @@ const AstExpr* parse_expr(Memory*       memory,
             expr = alloc_expr_call(memory,
                                    expr,
                                    parse_expr(memory, tokens, 0, depth + 1));
-            EXIT_IF((*tokens)->tag != TOKEN_RPAREN);
+            FAIL_IF((*tokens)->tag != TOKEN_RPAREN);
             ++(*tokens);
             break;
         }
@@ -474,12 +1039,12 @@ const AstExpr* parse_expr(Memory*       memory,
             break;
         }
         case TOKEN_RPAREN: {
-            EXIT_IF(depth == 0);
+            FAIL_IF(depth == 0);
             return expr;
         }
         case TOKEN_ARROW:
         default: {
-            EXIT();
+            FAIL();
         }
         }
     }
@@ -511,10 +1076,10 @@ static void print_intrinsic(IntrinsicTag tag) {
     }
 }
 
-static void print_expr(const AstExpr* expr) {
+static void print_expr(Memory* memory, const AstExpr* expr) {
     switch (expr->tag) {
     case AST_EXPR_IDENT: {
-        print_string(expr->body.as_string);
+        print_string(memory->symbols[expr->body.as_ident.symbol]);
         break;
     }
     case AST_EXPR_I64: {
@@ -522,30 +1087,30 @@ static void print_expr(const AstExpr* expr) {
         break;
     }
     case AST_EXPR_CALL: {
-        print_expr(expr->body.as_exprs[0]);
+        print_expr(memory, expr->body.as_exprs[0]);
         putchar('(');
-        print_expr(expr->body.as_exprs[1]);
+        print_expr(memory, expr->body.as_exprs[1]);
         putchar(')');
         break;
     }
     case AST_EXPR_FN0: {
         printf("(\\_");
         printf(" -> ");
-        print_expr(expr->body.as_fn0);
+        print_expr(memory, expr->body.as_fn0.expr);
         putchar(')');
         break;
     }
     case AST_EXPR_FN1: {
         printf("(\\");
-        print_string(expr->body.as_fn1.label);
+        print_string(memory->symbols[expr->body.as_fn1.symbol]);
         printf(" -> ");
-        print_expr(expr->body.as_fn1.expr);
+        print_expr(memory, expr->body.as_fn1.expr);
         putchar(')');
         break;
     }
     case AST_EXPR_INTRIN: {
         putchar('(');
-        print_expr(expr->body.as_intrinsic.expr);
+        print_expr(memory, expr->body.as_intrinsic.expr);
         printf(") ");
         print_intrinsic(expr->body.as_intrinsic.tag);
         putchar(' ');
@@ -561,64 +1126,103 @@ static void print_expr(const AstExpr* expr) {
     }
 }
 
-Env eval_expr(Memory*, Env);
+static Bool find_name(const Names* names,
+                      u32          symbol,
+                      Bool         visible,
+                      Address*     address) {
+    u32 len = names->len;
+    for (u32 depth = 0; names; ++depth) {
+        for (u32 i = 0; i < len; ++i) {
+            if (symbol == names->symbols[i]) {
+                *address = (Address){
+                    .depth = depth,
+                    .slot = i,
+                };
+                return TRUE;
+            }
+        }
+        if (names->parent) {
+            len = visible ? names->visible : names->parent->len;
+        }
+        names = names->parent;
+    }
+    return FALSE;
+}
 
-#define BINOP_I64(op)                                                       \
-    {                                                                       \
-        Env l = {                                                           \
-            .scope = scope,                                                 \
-            .expr = intrinsic.expr,                                         \
-        };                                                                  \
-        l = eval_expr(memory, l);                                           \
-        EXIT_IF(l.expr->tag != AST_EXPR_I64);                               \
-        Env r = {                                                           \
-            .scope = scope,                                                 \
-            .expr = arg,                                                    \
-        };                                                                  \
-        r = eval_expr(memory, r);                                           \
-        EXIT_IF(r.expr->tag != AST_EXPR_I64);                               \
-        return (Env){                                                       \
-            .scope = scope,                                                 \
-            .expr =                                                         \
-                alloc_expr_i64(memory,                                      \
-                               l.expr->body.as_i64 op r.expr->body.as_i64), \
-        };                                                                  \
-    }
-
-static Env eval_expr_intrinsic(Memory*        memory,
-                               Scope*         scope,
-                               Intrinsic      intrinsic,
-                               const AstExpr* arg) {
-    TRACE(intrinsic.expr);
-    switch (intrinsic.tag) {
-    case INTRIN_SEMICOLON: {
-        Env env = {
-            .scope = scope,
-            .expr = intrinsic.expr,
+static void resolve_ident(Memory* memory, const AstExpr* expr, Names* names) {
+    AstExpr* ident = &memory->nodes[get_node(memory, expr)];
+    FAIL_IF(!find_name(names,
+                       ident->body.as_ident.symbol,
+                       FALSE,
+                       &ident->body.as_ident.address));
+}
+
+static void resolve_assign(Memory* memory, const AstExpr* expr, Names* names) {
+    FAIL_IF(expr->tag != AST_EXPR_IDENT);
+    AstExpr* ident = &memory->nodes[get_node(memory, expr)];
+    if (find_name(names,
+                  ident->body.as_ident.symbol,
+                  TRUE,
+                  &ident->body.as_ident.address))
+    {
+        return;
+    }
+    FAIL_IF(CAP_NAMES <= names->len);
+    ident->body.as_ident.address = (Address){
+        .depth = 0,
+        .slot = names->len,
+    };
+    names->symbols[names->len++] = ident->body.as_ident.symbol;
+}
+
+static void resolve_expr(Memory*         memory,
+                         const AstExpr*  expr,
+                         Names*          names,
+                         Pending*        pending,
+                         u32*            len_pending) {
+    switch (expr->tag) {
+    case AST_EXPR_IDENT: {
+        resolve_ident(memory, expr, names);
+        break;
+    }
+    case AST_EXPR_FN0:
+    case AST_EXPR_FN1: {
+        FAIL_IF(CAP_NODES <= *len_pending);
+        pending[(*len_pending)++] = (Pending){
+            .fn = expr,
+            .visible = names->len,
         };
-        env = eval_expr(memory, env);
-        env.expr = arg;
-        return eval_expr(memory, (Env){.scope = scope, .expr = arg});
+        break;
     }
-    case INTRIN_ASSIGN: {
-        EXIT_IF(intrinsic.expr->tag != AST_EXPR_IDENT);
-        Env  env = eval_expr(memory, (Env){.scope = scope, .expr = arg});
-        Var* var = lookup_scope(scope, intrinsic.expr->body.as_string);
-        if (var) {
-            var->env = env;
+    case AST_EXPR_INTRIN: {
+        if (expr->body.as_intrinsic.tag == INTRIN_ASSIGN) {
+            resolve_assign(memory, expr->body.as_intrinsic.expr, names);
         } else {
-            push_var(memory, scope, intrinsic.expr->body.as_string, env);
+            resolve_expr(memory,
+                         expr->body.as_intrinsic.expr,
+                         names,
+                         pending,
+                         len_pending);
         }
-        return (Env){
-            .scope = scope,
-            .expr = NULL,
-        };
+        break;
     }
-    case INTRIN_ADD: {
-        BINOP_I64(+);
+    case AST_EXPR_CALL: {
+        const AstExpr* func = expr->body.as_exprs[0];
+        const AstExpr* arg = expr->body.as_exprs[1];
+        if ((func->tag == AST_EXPR_INTRIN) &&
+            (func->body.as_intrinsic.tag == INTRIN_ASSIGN))
+        {
+            resolve_expr(memory, arg, names, pending, len_pending);
+            resolve_assign(memory, func->body.as_intrinsic.expr, names);
+            break;
+        }
+        resolve_expr(memory, func, names, pending, len_pending);
+        resolve_expr(memory, arg, names, pending, len_pending);
+        break;
     }
-    case INTRIN_MUL: {
-        BINOP_I64(*);
+    case AST_EXPR_I64:
+    case AST_EXPR_VOID: {
+        break;
     }
     default: {
         EXIT();
@@ -626,145 +1230,1418 @@ static Env eval_expr_intrinsic(Memory*        memory,
     }
 }
 
-#undef BINOP_I64
+static void resolve_body(Memory* memory, const AstExpr* expr, Names* names) {
+    Pending pending[CAP_NODES];
+    u32     len_pending = 0;
+    resolve_expr(memory, expr, names, pending, &len_pending);
+    for (u32 i = 0; i < len_pending; ++i) {
+        AstExpr* fn = &memory->nodes[get_node(memory, pending[i].fn)];
+        Names    child = {
+            .len = 0,
+            .visible = pending[i].visible,
+            .parent = names,
+        };
+        if (fn->tag == AST_EXPR_FN0) {
+            resolve_body(memory, fn->body.as_fn0.expr, &child);
+            fn->body.as_fn0.len_slots = child.len;
+        } else {
+            child.symbols[child.len++] = fn->body.as_fn1.symbol;
+            resolve_body(memory, fn->body.as_fn1.expr, &child);
+            fn->body.as_fn1.len_slots = child.len;
+        }
+    }
+}
 
-static Env eval_expr_call(Memory*        memory,
-                          Scope*         scope,
-                          const AstExpr* func,
-                          const AstExpr* arg) {
-    TRACE(func);
-    switch (func->tag) {
-    case AST_EXPR_INTRIN: {
-        return eval_expr_intrinsic(memory,
-                                   scope,
-                                   func->body.as_intrinsic,
-                                   arg);
+static u32 resolve(Memory* memory, const AstExpr* expr) {
+    Names names = {
+        .len = 0,
+        .visible = 0,
+        .parent = NULL,
+    };
+    resolve_body(memory, expr, &names);
+    return names.len;
+}
+
+#define FRAME_TOP CAP_NODES
+
+static Fact* get_fact(Memory*        memory,
+                      const Lexical* lexical,
+                      Address        address) {
+    for (u32 i = 0; i < address.depth; ++i) {
+        lexical = lexical->parent;
     }
+    return &memory->facts[(lexical->frame * CAP_NAMES) + address.slot];
+}
+
+static Lexical push_lexical(Memory*        memory,
+                            const Lexical* lexical,
+                            const AstExpr* fn) {
+    return (Lexical){
+        .frame = get_node(memory, fn),
+        .parent = lexical,
+    };
+}
+
+static void count_facts(Memory*        memory,
+                        const AstExpr* expr,
+                        const Lexical* lexical) {
+    switch (expr->tag) {
     case AST_EXPR_IDENT: {
-        Env env = eval_expr(memory, (Env){.scope = scope, .expr = func});
-        return eval_expr_call(memory, env.scope, env.expr, arg);
-    }
-    case AST_EXPR_CALL: {
-        Env env = eval_expr_call(memory,
-                                 scope,
-                                 func->body.as_exprs[0],
-                                 func->body.as_exprs[1]);
-        return eval_expr_call(memory, env.scope, env.expr, arg);
+        ++get_fact(memory, lexical, expr->body.as_ident.address)->loads;
+        break;
     }
     case AST_EXPR_FN0: {
-        scope = push_scope(memory, scope);
-        return eval_expr(memory,
-                         (Env){.scope = scope, .expr = func->body.as_fn0});
+        Lexical child = push_lexical(memory, lexical, expr);
+        count_facts(memory, expr->body.as_fn0.expr, &child);
+        break;
     }
     case AST_EXPR_FN1: {
-        EXIT_IF(func->tag != AST_EXPR_FN1);
-        scope = push_scope(memory, scope);
-        push_var(memory,
-                 scope,
-                 func->body.as_fn1.label,
-                 (Env){.scope = scope, .expr = arg});
-        return eval_expr(
-            memory,
-            (Env){.scope = scope, .expr = func->body.as_fn1.expr});
-    }
-    case AST_EXPR_I64:
-    case AST_EXPR_VOID:
-    default: {
-        EXIT();
-    }
-    }
-}
-
-Env eval_expr(Memory* memory, Env env) {
-    TRACE(env.expr);
-    switch (env.expr->tag) {
-    case AST_EXPR_IDENT: {
-        Var* var = lookup_scope(env.scope, env.expr->body.as_string);
-        EXIT_IF(!var);
-        return var->env;
+        Lexical child = push_lexical(memory, lexical, expr);
+        count_facts(memory, expr->body.as_fn1.expr, &child);
+        break;
     }
-    case AST_EXPR_I64:
-    case AST_EXPR_FN0:
-    case AST_EXPR_FN1:
     case AST_EXPR_INTRIN: {
-        return env;
+        Intrinsic intrinsic = expr->body.as_intrinsic;
+        if (intrinsic.tag == INTRIN_ASSIGN) {
+            ++get_fact(memory, lexical, intrinsic.expr->body.as_ident.address)
+                  ->stores;
+        } else {
+            count_facts(memory, intrinsic.expr, lexical);
+        }
+        break;
     }
     case AST_EXPR_CALL: {
-        return eval_expr_call(memory,
-                              env.scope,
-                              env.expr->body.as_exprs[0],
-                              env.expr->body.as_exprs[1]);
+        count_facts(memory, expr->body.as_exprs[0], lexical);
+        count_facts(memory, expr->body.as_exprs[1], lexical);
+        break;
+    }
+    case AST_EXPR_I64:
+    case AST_EXPR_VOID: {
+        break;
     }
-    case AST_EXPR_VOID:
     default: {
         EXIT();
     }
     }
 }
 
-static const Token TOKENS[] = {
-    {.body = {.as_string = STRING("x")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_ASSIGN},
-    {.body = {.as_i64 = 1}, .tag = TOKEN_I64},
-    {.tag = TOKEN_SEMICOLON},
-    {.body = {.as_string = STRING("y")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_ASSIGN},
-    {.body = {.as_string = STRING("x")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_SEMICOLON},
-    {.body = {.as_string = STRING("f0")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_ASSIGN},
-    {.tag = TOKEN_LPAREN},
-    {.tag = TOKEN_BACKSLASH},
-    {.tag = TOKEN_ARROW},
-    {.body = {.as_string = STRING("i")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_ASSIGN},
-    {.body = {.as_i64 = 0}, .tag = TOKEN_I64},
-    {.tag = TOKEN_SEMICOLON},
-    {.body = {.as_string = STRING("f1")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_ASSIGN},
-    {.tag = TOKEN_LPAREN},
-    {.tag = TOKEN_BACKSLASH},
-    {.tag = TOKEN_ARROW},
-    {.body = {.as_string = STRING("i")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_ASSIGN},
-    {.body = {.as_string = STRING("i")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_ADD},
-    {.body = {.as_string = STRING("y")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_SEMICOLON},
-    {.body = {.as_string = STRING("i")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_RPAREN},
-    {.tag = TOKEN_SEMICOLON},
-    {.body = {.as_string = STRING("f4")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_ASSIGN},
-    {.body = {.as_string = STRING("f1")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_SEMICOLON},
-    {.body = {.as_string = STRING("f4")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_RPAREN},
-    {.tag = TOKEN_SEMICOLON},
-    {.body = {.as_string = STRING("f3")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_ASSIGN},
-    {.body = {.as_string = STRING("f0")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_SEMICOLON},
-    {.body = {.as_string = STRING("f2")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_ASSIGN},
-    {.body = {.as_string = STRING("f3")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_VOID},
-    {.tag = TOKEN_SEMICOLON},
-    {.body = {.as_string = STRING("f2")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_VOID},
-    {.tag = TOKEN_SEMICOLON},
-    {.body = {.as_string = STRING("f2")}, .tag = TOKEN_IDENT},
-    {.tag = TOKEN_VOID},
-    {.tag = TOKEN_END},
-};
-
-i32 main(void) {
-    printf("\n"
-           "sizeof(Token)       : %zu\n"
+static void define_fact(Memory*        memory,
+                        const Lexical* lexical,
+                        const AstExpr* ident,
+                        const AstExpr* expr) {
+    Fact* fact = get_fact(memory, lexical, ident->body.as_ident.address);
+    if (fact->stores != 1) {
+        return;
+    }
+    fact->defined = TRUE;
+    switch (expr->tag) {
+    case AST_EXPR_I64: {
+        fact->body.as_i64 = expr->body.as_i64;
+        fact->tag = FACT_I64;
+        fact->pure = TRUE;
+        break;
+    }
+    case AST_EXPR_IDENT: {
+        Address address = expr->body.as_ident.address;
+        if (!get_fact(memory, lexical, address)->defined) {
+            break;
+        }
+        const Lexical* target = lexical;
+        for (u32 i = 0; i < address.depth; ++i) {
+            target = target->parent;
+        }
+        fact->body.as_alias = (Target){
+            .symbol = expr->body.as_ident.symbol,
+            .frame = target->frame,
+            .slot = address.slot,
+        };
+        fact->tag = FACT_ALIAS;
+        fact->pure = TRUE;
+        break;
+    }
+    case AST_EXPR_FN0:
+    case AST_EXPR_FN1: {
+        fact->pure = TRUE;
+        break;
+    }
+    case AST_EXPR_CALL:
+    case AST_EXPR_INTRIN:
+    case AST_EXPR_VOID:
+    default: {
+        break;
+    }
+    }
+}
+
+#define FOLD_I64(overflow)                                               \
+    {                                                                    \
+        const AstExpr* left = intrinsic.expr;                            \
+        fold_expr(memory, left, lexical, FALSE);                         \
+        fold_expr(memory, arg, lexical, FALSE);                          \
+        i64 x;                                                           \
+        if ((left->tag == AST_EXPR_I64) && (arg->tag == AST_EXPR_I64) && \
+            (!overflow(left->body.as_i64, arg->body.as_i64, &x)) &&      \
+            (LITERAL_MIN <= x) && (x <= LITERAL_MAX))                    \
+        {                                                                \
+            node->body.as_i64 = x;                                       \
+            node->tag = AST_EXPR_I64;                                    \
+        }                                                                \
+        break;                                                           \
+    }
+
+static void fold_expr(Memory*        memory,
+                      const AstExpr* expr,
+                      const Lexical* lexical,
+                      Bool           spine) {
+    AstExpr* node = &memory->nodes[get_node(memory, expr)];
+    switch (node->tag) {
+    case AST_EXPR_IDENT: {
+        Fact* fact = get_fact(memory, lexical, node->body.as_ident.address);
+        switch (fact->tag) {
+        case FACT_I64: {
+            node->body.as_i64 = fact->body.as_i64;
+            node->tag = AST_EXPR_I64;
+            break;
+        }
+        case FACT_ALIAS: {
+            Target target = fact->body.as_alias;
+            u32    depth = 0;
+            for (; lexical->frame != target.frame; ++depth) {
+                lexical = lexical->parent;
+                EXIT_IF(!lexical);
+            }
+            node->body.as_ident = (AstIdent){
+                .symbol = target.symbol,
+                .address = {.depth = depth, .slot = target.slot},
+            };
+            break;
+        }
+        case FACT_NONE: {
+            break;
+        }
+        default: {
+            EXIT();
+        }
+        }
+        break;
+    }
+    case AST_EXPR_FN0: {
+        Lexical child = push_lexical(memory, lexical, node);
+        fold_expr(memory, node->body.as_fn0.expr, &child, TRUE);
+        break;
+    }
+    case AST_EXPR_FN1: {
+        Lexical child = push_lexical(memory, lexical, node);
+        Fact*   param = &memory->facts[child.frame * CAP_NAMES];
+        param->defined = param->stores == 0;
+        fold_expr(memory, node->body.as_fn1.expr, &child, TRUE);
+        break;
+    }
+    case AST_EXPR_INTRIN: {
+        if (node->body.as_intrinsic.tag != INTRIN_ASSIGN) {
+            fold_expr(memory, node->body.as_intrinsic.expr, lexical, FALSE);
+        }
+        break;
+    }
+    case AST_EXPR_CALL: {
+        const AstExpr* func = node->body.as_exprs[0];
+        const AstExpr* arg = node->body.as_exprs[1];
+        if (func->tag != AST_EXPR_INTRIN) {
+            fold_expr(memory, func, lexical, FALSE);
+            fold_expr(memory, arg, lexical, FALSE);
+            break;
+        }
+        Intrinsic intrinsic = func->body.as_intrinsic;
+        switch (intrinsic.tag) {
+        case INTRIN_SEMICOLON: {
+            fold_expr(memory, intrinsic.expr, lexical, spine);
+            fold_expr(memory, arg, lexical, spine);
+            break;
+        }
+        case INTRIN_ASSIGN: {
+            fold_expr(memory, arg, lexical, FALSE);
+            if (spine && (intrinsic.expr->body.as_ident.address.depth == 0)) {
+                define_fact(memory, lexical, intrinsic.expr, arg);
+            }
+            break;
+        }
+        case INTRIN_ADD: {
+            FOLD_I64(__builtin_add_overflow);
+        }
+        case INTRIN_MUL: {
+            FOLD_I64(__builtin_mul_overflow);
+        }
+        default: {
+            EXIT();
+        }
+        }
+        break;
+    }
+    case AST_EXPR_I64:
+    case AST_EXPR_VOID: {
+        break;
+    }
+    default: {
+        EXIT();
+    }
+    }
+}
+
+#undef FOLD_I64
+
+static Bool is_dead(Memory*        memory,
+                    const AstExpr* expr,
+                    const Lexical* lexical) {
+    if ((expr->tag != AST_EXPR_CALL) ||
+        (expr->body.as_exprs[0]->tag != AST_EXPR_INTRIN))
+    {
+        return FALSE;
+    }
+    Intrinsic intrinsic = expr->body.as_exprs[0]->body.as_intrinsic;
+    if (intrinsic.tag != INTRIN_ASSIGN) {
+        return FALSE;
+    }
+    Fact* fact =
+        get_fact(memory, lexical, intrinsic.expr->body.as_ident.address);
+    return fact->pure && (fact->stores == 1) && (fact->loads == 0);
+}
+
+static void prune_expr(Memory*        memory,
+                       const AstExpr* expr,
+                       const Lexical* lexical,
+                       Bool           discard) {
+    AstExpr* node = &memory->nodes[get_node(memory, expr)];
+    switch (node->tag) {
+    case AST_EXPR_FN0: {
+        Lexical child = push_lexical(memory, lexical, node);
+        prune_expr(memory, node->body.as_fn0.expr, &child, FALSE);
+        break;
+    }
+    case AST_EXPR_FN1: {
+        Lexical child = push_lexical(memory, lexical, node);
+        prune_expr(memory, node->body.as_fn1.expr, &child, FALSE);
+        break;
+    }
+    case AST_EXPR_INTRIN: {
+        prune_expr(memory, node->body.as_intrinsic.expr, lexical, FALSE);
+        break;
+    }
+    case AST_EXPR_CALL: {
+        const AstExpr* func = node->body.as_exprs[0];
+        const AstExpr* arg = node->body.as_exprs[1];
+        if ((func->tag != AST_EXPR_INTRIN) ||
+            (func->body.as_intrinsic.tag != INTRIN_SEMICOLON))
+        {
+            prune_expr(memory, func, lexical, FALSE);
+            prune_expr(memory, arg, lexical, FALSE);
+            break;
+        }
+        const AstExpr* first = func->body.as_intrinsic.expr;
+        prune_expr(memory, first, lexical, TRUE);
+        prune_expr(memory, arg, lexical, discard);
+        if (discard && is_dead(memory, arg, lexical)) {
+            *node = *first;
+        } else if (is_dead(memory, first, lexical)) {
+            *node = *arg;
+        }
+        break;
+    }
+    case AST_EXPR_IDENT:
+    case AST_EXPR_I64:
+    case AST_EXPR_VOID: {
+        break;
+    }
+    default: {
+        EXIT();
+    }
+    }
+}
+
+static void optimize(Memory* memory, const AstExpr* expr) {
+    for (u32 i = 0; i < CAP_FACTS; ++i) {
+        memory->facts[i] = (Fact){0};
+    }
+    Lexical top = {.frame = FRAME_TOP, .parent = NULL};
+    count_facts(memory, expr, &top);
+    fold_expr(memory, expr, &top, TRUE);
+    for (u32 i = 0; i < CAP_FACTS; ++i) {
+        memory->facts[i].stores = 0;
+        memory->facts[i].loads = 0;
+    }
+    count_facts(memory, expr, &top);
+    prune_expr(memory, expr, &top, FALSE);
+}
+
+static Bool is_native(const AstExpr* expr, Bool value) {
+    switch (expr->tag) {
+    case AST_EXPR_I64: {
+        return TRUE;
+    }
+    case AST_EXPR_IDENT: {
+        return expr->body.as_ident.address.depth == 0;
+    }
+    case AST_EXPR_CALL: {
+        const AstExpr* func = expr->body.as_exprs[0];
+        const AstExpr* arg = expr->body.as_exprs[1];
+        if (func->tag != AST_EXPR_INTRIN) {
+            return FALSE;
+        }
+        Intrinsic intrinsic = func->body.as_intrinsic;
+        switch (intrinsic.tag) {
+        case INTRIN_SEMICOLON: {
+            return is_native(intrinsic.expr, FALSE) && is_native(arg, value);
+        }
+        case INTRIN_ASSIGN: {
+            return (!value) &&
+                   (intrinsic.expr->body.as_ident.address.depth == 0) &&
+                   is_native(arg, TRUE);
+        }
+        case INTRIN_ADD:
+        case INTRIN_MUL: {
+            return is_native(intrinsic.expr, TRUE) && is_native(arg, TRUE);
+        }
+        default: {
+            EXIT();
+        }
+        }
+    }
+    case AST_EXPR_FN0:
+    case AST_EXPR_FN1:
+    case AST_EXPR_INTRIN:
+    case AST_EXPR_VOID:
+    default: {
+        return FALSE;
+    }
+    }
+}
+
+static void push_jit(Memory* memory, const u8* bytes, u32 len) {
+    EXIT_IF(CAP_JIT < (memory->len_jit + len));
+    memcpy(&memory->jit[memory->len_jit], bytes, len);
+    memory->len_jit += len;
+}
+
+#define PUSH_JIT(...)                                \
+    {                                                \
+        const u8 bytes[] = {__VA_ARGS__};            \
+        push_jit(memory, bytes, (u32)sizeof(bytes)); \
+    }
+
+#define PUSH_JIT_U64(x)                                        \
+    {                                                          \
+        u64 bytes = x;                                         \
+        push_jit(memory, (const u8*)&bytes, (u32)sizeof(u64)); \
+    }
+
+static void emit_overflow(Memory* memory) {
+    // NOTE: `jo rel8`, `mov rcx, rax`, `add rcx, rcx`, `jno rel8`,
+    // `mov rsp, rdx`, `mov rax, imm64`, `ret`
+    PUSH_JIT(0x70, 0x08, 0x48, 0x89, 0xC1, 0x48, 0x01, 0xC9, 0x71, 0x0E);
+    PUSH_JIT(0x48, 0x89, 0xD4, 0x48, 0xB8);
+    PUSH_JIT_U64((u64)NATIVE_OVERFLOW);
+    PUSH_JIT(0xC3);
+}
+
+static void emit_native(Memory* memory, const AstExpr* expr) {
+    switch (expr->tag) {
+    case AST_EXPR_I64: {
+        // NOTE: `mov rax, imm64`
+        PUSH_JIT(0x48, 0xB8);
+        PUSH_JIT_U64((u64)expr->body.as_i64);
+        break;
+    }
+    case AST_EXPR_IDENT: {
+        u8 disp = (u8)(expr->body.as_ident.address.slot * sizeof(i64));
+        // NOTE: `mov rax, [rdi + disp8]`
+        PUSH_JIT(0x48, 0x8B, 0x47, disp);
+        break;
+    }
+    case AST_EXPR_CALL: {
+        Intrinsic      intrinsic = expr->body.as_exprs[0]->body.as_intrinsic;
+        const AstExpr* arg = expr->body.as_exprs[1];
+        switch (intrinsic.tag) {
+        case INTRIN_SEMICOLON: {
+            emit_native(memory, intrinsic.expr);
+            emit_native(memory, arg);
+            break;
+        }
+        case INTRIN_ASSIGN: {
+            u8 disp =
+                (u8)(intrinsic.expr->body.as_ident.address.slot * sizeof(i64));
+            emit_native(memory, arg);
+            // NOTE: `mov [rdi + disp8], rax`
+            PUSH_JIT(0x48, 0x89, 0x47, disp);
+            break;
+        }
+        case INTRIN_ADD: {
+            // NOTE: `push rax`, `pop rcx`, `add rax, rcx`
+            emit_native(memory, intrinsic.expr);
+            PUSH_JIT(0x50);
+            emit_native(memory, arg);
+            PUSH_JIT(0x59, 0x48, 0x01, 0xC8);
+            emit_overflow(memory);
+            break;
+        }
+        case INTRIN_MUL: {
+            // NOTE: `push rax`, `pop rcx`, `imul rax, rcx`
+            emit_native(memory, intrinsic.expr);
+            PUSH_JIT(0x50);
+            emit_native(memory, arg);
+            PUSH_JIT(0x59, 0x48, 0x0F, 0xAF, 0xC1);
+            emit_overflow(memory);
+            break;
+        }
+        default: {
+            EXIT();
+        }
+        }
+        break;
+    }
+    case AST_EXPR_FN0:
+    case AST_EXPR_FN1:
+    case AST_EXPR_INTRIN:
+    case AST_EXPR_VOID:
+    default: {
+        EXIT();
+    }
+    }
+}
+
+static u32 compile_native(Memory* memory, const AstExpr* fn) {
+    const AstExpr* body =
+        fn->tag == AST_EXPR_FN0 ? fn->body.as_fn0.expr : fn->body.as_fn1.expr;
+    if (!is_native(body, TRUE)) {
+        return NATIVE_SKIP;
+    }
+    if (!memory->jit) {
+        void* address = mmap(NULL,
+                             CAP_JIT,
+                             PROT_READ | PROT_WRITE,
+                             MAP_ANONYMOUS | MAP_PRIVATE,
+                             -1,
+                             0);
+        if (address == MAP_FAILED) {
+            return NATIVE_SKIP;
+        }
+        memory->jit = address;
+    } else {
+        EXIT_IF(mprotect(memory->jit, CAP_JIT, PROT_READ | PROT_WRITE));
+    }
+    u32 offset = memory->len_jit;
+    // NOTE: `mov rdx, rsp`
+    PUSH_JIT(0x48, 0x89, 0xE2);
+    emit_native(memory, body);
+    // NOTE: `ret`
+    PUSH_JIT(0xC3);
+    EXIT_IF(mprotect(memory->jit, CAP_JIT, PROT_READ | PROT_EXEC));
+    return offset;
+}
+
+#undef PUSH_JIT
+#undef PUSH_JIT_U64
+
+static Bool call_native(Memory* memory, Env func, Env arg, Env* result) {
+    u32 node = get_node(memory, func.expr);
+    if (memory->natives[node] == NATIVE_NONE) {
+        if (++memory->calls[node] < JIT_THRESHOLD) {
+            return FALSE;
+        }
+        memory->natives[node] = compile_native(memory, func.expr);
+    }
+    if (memory->natives[node] == NATIVE_SKIP) {
+        return FALSE;
+    }
+    i64 slots[CAP_NAMES] = {0};
+    if (func.expr->tag == AST_EXPR_FN1) {
+        if ((!is_i64(arg)) && (arg.expr->tag != AST_EXPR_I64)) {
+            return FALSE;
+        }
+        slots[0] = get_i64(arg);
+    }
+    i64 x = ((JitFn)(void*)&memory->jit[memory->natives[node]])(slots);
+    FAIL_IF(x == NATIVE_OVERFLOW);
+    *result = pack_i64(func.scope, x);
+    return TRUE;
+}
+
+Env eval_expr(Memory*, Env);
+
+static void push_kont(Memory* memory, KontTag tag, Env env) {
+    FAIL_IF(CAP_KONTS <= memory->len_konts);
+    memory->konts[memory->len_konts++] = (Kont){
+        .env = env,
+        .tag = tag,
+    };
+}
+
+static Kont pop_kont(Memory* memory) {
+    EXIT_IF(memory->len_konts == 0);
+    return memory->konts[--memory->len_konts];
+}
+
+static u64 get_monotonic(void) {
+    Time time;
+    EXIT_IF(clock_gettime(CLOCK_MONOTONIC, &time));
+    return (((u64)time.tv_sec) * NANO_PER_SECOND) + ((u64)time.tv_nsec);
+}
+
+static void begin_sample(Memory* memory, Env env) {
+    EXIT_IF(CAP_KONTS <= memory->len_samples);
+    memory->samples[memory->len_samples++] = (Sample){
+        .start = get_monotonic(),
+        .allocs = memory->len_allocs,
+        .node = get_node(memory, env.expr),
+        .path = memory->path,
+    };
+    push_kont(memory, KONT_PROFILE, env);
+}
+
+static void end_sample(Memory* memory) {
+    EXIT_IF(memory->len_samples == 0);
+    Sample   sample = memory->samples[--memory->len_samples];
+    u64      nanos = get_monotonic() - sample.start;
+    Profile* profile = &memory->profiles[sample.node];
+    profile->allocs += memory->len_allocs - sample.allocs;
+    profile->nanos += nanos;
+    if (memory->path != sample.path) {
+        memory->paths[memory->path].nanos += nanos;
+        memory->path = sample.path;
+    }
+}
+
+static void profile_call(Memory* memory, Env func) {
+    u32 node = get_node(memory, func.expr);
+    ++memory->profiles[node].count;
+    begin_sample(memory, func);
+    for (u32 i = 1; i < memory->len_paths; ++i) {
+        if ((memory->paths[i].parent == memory->path) &&
+            (memory->paths[i].node == node))
+        {
+            memory->path = i;
+            return;
+        }
+    }
+    if (memory->len_paths < CAP_PATHS) {
+        memory->paths[memory->len_paths] = (Path){
+            .nanos = 0,
+            .node = node,
+            .parent = memory->path,
+        };
+        memory->path = memory->len_paths++;
+    }
+}
+
+#define BINOP_LEFT(tag)              \
+    {                                \
+        push_kont(memory, tag, env); \
+        env = kont.env;              \
+        goto eval;                   \
+    }
+
+#define BINOP_RIGHT(fn)                              \
+    {                                                \
+        i64 l = get_operand(memory, kont.env);       \
+        i64 r = get_operand(memory, env);            \
+        env = pack_i64(env.scope, fn(memory, l, r)); \
+        goto ret;                                    \
+    }
+
+// NOTE: Calls and the right-hand side of `;` push no continuation, so tail
+// calls run in constant space.
+static Env eval_kont(Memory* memory, Env env, u32 base) {
+eval:
+    if (is_i64(env)) {
+        goto ret;
+    }
+    TRACE(env.expr);
+    if (memory->profiling && (env.expr->tag != AST_EXPR_FN0) &&
+        (env.expr->tag != AST_EXPR_FN1))
+    {
+        ++memory->profiles[get_node(memory, env.expr)].count;
+        if (env.expr->tag == AST_EXPR_CALL) {
+            begin_sample(memory, env);
+        }
+    }
+    switch (env.expr->tag) {
+    case AST_EXPR_IDENT: {
+        Env* slot = get_slot(env.scope, env.expr->body.as_ident.address);
+        FAIL_IF(!slot->scope);
+        env = *slot;
+        goto ret;
+    }
+    case AST_EXPR_I64: {
+        env = pack_i64(env.scope, env.expr->body.as_i64);
+        goto ret;
+    }
+    case AST_EXPR_FN0:
+    case AST_EXPR_FN1:
+    case AST_EXPR_INTRIN: {
+        goto ret;
+    }
+    case AST_EXPR_CALL: {
+        push_kont(
+            memory,
+            KONT_APPLY,
+            (Env){.scope = env.scope, .expr = env.expr->body.as_exprs[1]});
+        env.expr = env.expr->body.as_exprs[0];
+        goto eval;
+    }
+    case AST_EXPR_VOID: {
+        FAIL();
+    }
+    default: {
+        EXIT();
+    }
+    }
+ret:
+    if (memory->len_konts == base) {
+        return env;
+    }
+    Kont kont = pop_kont(memory);
+    switch (kont.tag) {
+    case KONT_APPLY: {
+        FAIL_IF(is_i64(env) || (!env.expr));
+        const AstExpr* func = env.expr;
+        TRACE(func);
+        switch (func->tag) {
+        case AST_EXPR_INTRIN: {
+            Intrinsic intrinsic = func->body.as_intrinsic;
+            switch (intrinsic.tag) {
+            case INTRIN_SEMICOLON: {
+                push_kont(memory, KONT_SEMICOLON, kont.env);
+                env.expr = intrinsic.expr;
+                goto eval;
+            }
+            case INTRIN_ASSIGN: {
+                EXIT_IF(intrinsic.expr->tag != AST_EXPR_IDENT);
+                env.expr = intrinsic.expr;
+                push_kont(memory, KONT_ASSIGN, env);
+                env = kont.env;
+                goto eval;
+            }
+            case INTRIN_ADD: {
+                push_kont(memory, KONT_ADD_LEFT, kont.env);
+                env.expr = intrinsic.expr;
+                goto eval;
+            }
+            case INTRIN_MUL: {
+                push_kont(memory, KONT_MUL_LEFT, kont.env);
+                env.expr = intrinsic.expr;
+                goto eval;
+            }
+            default: {
+                EXIT();
+            }
+            }
+        }
+        case AST_EXPR_IDENT:
+        case AST_EXPR_CALL: {
+            push_kont(memory, KONT_APPLY, kont.env);
+            goto eval;
+        }
+        case AST_EXPR_FN0: {
+            if (memory->profiling) {
+                profile_call(memory, env);
+            }
+            if (call_native(memory, env, kont.env, &env)) {
+                goto ret;
+            }
+            env.scope = push_call(memory, env, kont.env);
+            env.expr = func->body.as_fn0.expr;
+            goto eval;
+        }
+        case AST_EXPR_FN1: {
+            if (memory->profiling) {
+                profile_call(memory, env);
+            }
+            if (call_native(memory, env, kont.env, &env)) {
+                goto ret;
+            }
+            env.scope = push_call(memory, env, kont.env);
+            env.expr = func->body.as_fn1.expr;
+            goto eval;
+        }
+        case AST_EXPR_I64:
+        case AST_EXPR_VOID: {
+            FAIL();
+        }
+        default: {
+            EXIT();
+        }
+        }
+    }
+    case KONT_SEMICOLON: {
+        env = kont.env;
+        goto eval;
+    }
+    case KONT_ASSIGN: {
+        *get_slot(kont.env.scope, kont.env.expr->body.as_ident.address) = env;
+        env = (Env){
+            .scope = kont.env.scope,
+            .expr = NULL,
+        };
+        goto ret;
+    }
+    case KONT_ADD_LEFT: {
+        BINOP_LEFT(KONT_ADD_RIGHT);
+    }
+    case KONT_MUL_LEFT: {
+        BINOP_LEFT(KONT_MUL_RIGHT);
+    }
+    case KONT_ADD_RIGHT: {
+        BINOP_RIGHT(add_i64);
+    }
+    case KONT_MUL_RIGHT: {
+        BINOP_RIGHT(mul_i64);
+    }
+    case KONT_PROFILE: {
+        end_sample(memory);
+        goto ret;
+    }
+    default: {
+        EXIT();
+    }
+    }
+}
+
+#undef BINOP_LEFT
+#undef BINOP_RIGHT
+
+Env eval_expr(Memory* memory, Env env) {
+    return eval_kont(memory, env, memory->len_konts);
+}
+
+static Env eval_expr_call(Memory* memory, Env func, Env arg) {
+    u32 base = memory->len_konts;
+    push_kont(memory, KONT_APPLY, arg);
+    return eval_kont(memory, func, base);
+}
+
+static String get_label(Memory* memory, u32 node) {
+    for (u32 i = 0; i < memory->len_nodes; ++i) {
+        const AstExpr* expr = &memory->nodes[i];
+        if ((expr->tag != AST_EXPR_CALL) ||
+            (expr->body.as_exprs[1] != &memory->nodes[node]) ||
+            (expr->body.as_exprs[0]->tag != AST_EXPR_INTRIN))
+        {
+            continue;
+        }
+        Intrinsic intrinsic = expr->body.as_exprs[0]->body.as_intrinsic;
+        if (intrinsic.tag == INTRIN_ASSIGN) {
+            return memory->symbols[intrinsic.expr->body.as_ident.symbol];
+        }
+    }
+    return STRING("_");
+}
+
+static void print_node(Memory* memory, u32 node) {
+    const AstExpr* expr = &memory->nodes[node];
+    switch (expr->tag) {
+    case AST_EXPR_FN0:
+    case AST_EXPR_FN1: {
+        putchar('\\');
+        print_string(get_label(memory, node));
+        break;
+    }
+    case AST_EXPR_CALL: {
+        const AstExpr* func = expr->body.as_exprs[0];
+        if (func->tag == AST_EXPR_INTRIN) {
+            print_intrinsic(func->body.as_intrinsic.tag);
+        } else if (func->tag == AST_EXPR_IDENT) {
+            print_string(memory->symbols[func->body.as_ident.symbol]);
+            printf(" _");
+        } else {
+            printf("_ _");
+        }
+        break;
+    }
+    case AST_EXPR_INTRIN: {
+        print_intrinsic(expr->body.as_intrinsic.tag);
+        break;
+    }
+    case AST_EXPR_IDENT:
+    case AST_EXPR_I64:
+    case AST_EXPR_VOID: {
+        print_expr(memory, expr);
+        break;
+    }
+    default: {
+        EXIT();
+    }
+    }
+}
+
+static void print_profile(Memory* memory) {
+    u32 order[CAP_NODES];
+    u32 len = 0;
+    for (u32 i = 0; i < memory->len_nodes; ++i) {
+        if (memory->profiles[i].count == 0) {
+            continue;
+        }
+        u32 j = len++;
+        for (; (j != 0) && (memory->profiles[order[j - 1]].nanos <
+                            memory->profiles[i].nanos);
+             --j)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+    printf("%12s %8s %8s %6s  node\n", "nanos", "count", "allocs", "index");
+    for (u32 i = 0; i < len; ++i) {
+        Profile profile = memory->profiles[order[i]];
+        printf("%12lu %8lu %8lu %6u  ",
+               profile.nanos,
+               profile.count,
+               profile.allocs,
+               order[i]);
+        print_node(memory, order[i]);
+        putchar('\n');
+    }
+}
+
+static void print_path(Memory* memory, u32 path) {
+    if (path == 0) {
+        printf("main");
+        return;
+    }
+    print_path(memory, memory->paths[path].parent);
+    putchar(';');
+    print_string(get_label(memory, memory->paths[path].node));
+}
+
+static void print_folded(Memory* memory) {
+    for (u32 i = 1; i < memory->len_paths; ++i) {
+        u64 nanos = memory->paths[i].nanos;
+        for (u32 j = i + 1; j < memory->len_paths; ++j) {
+            if (memory->paths[j].parent == i) {
+                nanos -= memory->paths[j].nanos;
+            }
+        }
+        print_path(memory, i);
+        printf(" %lu\n", nanos);
+    }
+}
+
+#define ENTRY_NONE 0xFFFFFFFF
+
+static void emit_op(Memory* memory, OpTag tag, const AstExpr* expr) {
+    FAIL_IF(CAP_CODE <= memory->len_code);
+    memory->code[memory->len_code++] = (Op){
+        .node = expr ? get_node(memory, expr) : 0,
+        .tag = tag,
+    };
+}
+
+static void compile_expr(Memory*         memory,
+                         const AstExpr*  expr,
+                         const AstExpr** pending,
+                         u32*            len_pending) {
+    switch (expr->tag) {
+    case AST_EXPR_IDENT: {
+        emit_op(memory, OP_LOAD, expr);
+        break;
+    }
+    case AST_EXPR_FN0:
+    case AST_EXPR_FN1: {
+        EXIT_IF(CAP_NODES <= *len_pending);
+        pending[(*len_pending)++] = expr;
+        emit_op(memory, OP_PUSH, expr);
+        break;
+    }
+    case AST_EXPR_I64:
+    case AST_EXPR_INTRIN: {
+        emit_op(memory, OP_PUSH, expr);
+        break;
+    }
+    case AST_EXPR_VOID: {
+        emit_op(memory, OP_VOID, expr);
+        break;
+    }
+    case AST_EXPR_CALL: {
+        const AstExpr* func = expr->body.as_exprs[0];
+        const AstExpr* arg = expr->body.as_exprs[1];
+        if (func->tag != AST_EXPR_INTRIN) {
+            compile_expr(memory, func, pending, len_pending);
+            emit_op(memory, OP_CALL, arg);
+            break;
+        }
+        Intrinsic intrinsic = func->body.as_intrinsic;
+        switch (intrinsic.tag) {
+        case INTRIN_SEMICOLON: {
+            compile_expr(memory, intrinsic.expr, pending, len_pending);
+            emit_op(memory, OP_DROP, NULL);
+            compile_expr(memory, arg, pending, len_pending);
+            break;
+        }
+        case INTRIN_ASSIGN: {
+            EXIT_IF(intrinsic.expr->tag != AST_EXPR_IDENT);
+            compile_expr(memory, arg, pending, len_pending);
+            emit_op(memory, OP_STORE, intrinsic.expr);
+            break;
+        }
+        case INTRIN_ADD: {
+            compile_expr(memory, intrinsic.expr, pending, len_pending);
+            compile_expr(memory, arg, pending, len_pending);
+            emit_op(memory, OP_ADD, NULL);
+            break;
+        }
+        case INTRIN_MUL: {
+            compile_expr(memory, intrinsic.expr, pending, len_pending);
+            compile_expr(memory, arg, pending, len_pending);
+            emit_op(memory, OP_MUL, NULL);
+            break;
+        }
+        default: {
+            EXIT();
+        }
+        }
+        break;
+    }
+    default: {
+        EXIT();
+    }
+    }
+}
+
+static void compile_code(Memory* memory, const AstExpr* expr) {
+    const AstExpr* pending[CAP_NODES];
+    u32            len_pending = 0;
+    memory->len_code = 0;
+    for (u32 i = 0; i < CAP_NODES; ++i) {
+        memory->entries[i] = ENTRY_NONE;
+    }
+    compile_expr(memory, expr, pending, &len_pending);
+    emit_op(memory, OP_HALT, NULL);
+    for (u32 i = 0; i < len_pending; ++i) {
+        const AstExpr* fn = pending[i];
+        memory->entries[get_node(memory, fn)] = memory->len_code;
+        compile_expr(memory,
+                     fn->tag == AST_EXPR_FN0 ? fn->body.as_fn0.expr
+                                             : fn->body.as_fn1.expr,
+                     pending,
+                     &len_pending);
+        emit_op(memory, OP_RET, NULL);
+    }
+}
+
+static void print_code(Memory* memory) {
+    for (u32 i = 0; i < memory->len_code; ++i) {
+        Op op = memory->code[i];
+        printf("%4u  ", i);
+        switch (op.tag) {
+        case OP_PUSH: {
+            printf("push   ");
+            print_expr(memory, &memory->nodes[op.node]);
+            break;
+        }
+        case OP_LOAD: {
+            AstIdent ident = memory->nodes[op.node].body.as_ident;
+            printf("load   %u:%u ", ident.address.depth, ident.address.slot);
+            print_string(memory->symbols[ident.symbol]);
+            break;
+        }
+        case OP_STORE: {
+            AstIdent ident = memory->nodes[op.node].body.as_ident;
+            printf("store  %u:%u ", ident.address.depth, ident.address.slot);
+            print_string(memory->symbols[ident.symbol]);
+            break;
+        }
+        case OP_DROP: {
+            printf("drop");
+            break;
+        }
+        case OP_ADD: {
+            printf("add");
+            break;
+        }
+        case OP_MUL: {
+            printf("mul");
+            break;
+        }
+        case OP_CALL: {
+            printf("call   ");
+            print_expr(memory, &memory->nodes[op.node]);
+            break;
+        }
+        case OP_RET: {
+            printf("ret");
+            break;
+        }
+        case OP_VOID: {
+            printf("void");
+            break;
+        }
+        case OP_HALT: {
+            printf("halt");
+            break;
+        }
+        default: {
+            EXIT();
+        }
+        }
+        putchar('\n');
+    }
+}
+
+static void push_stack(Memory* memory, Env env) {
+    FAIL_IF(CAP_STACK <= memory->len_stack);
+    memory->stack[memory->len_stack++] = env;
+}
+
+static Env pop_stack(Memory* memory) {
+    EXIT_IF(memory->len_stack == 0);
+    return memory->stack[--memory->len_stack];
+}
+
+#define DISPATCH()               \
+    {                            \
+        op = memory->code[pc++]; \
+        goto *LABELS[op.tag];    \
+    }
+
+#define BINOP_I64(fn)                                          \
+    {                                                          \
+        i64 r = get_operand(memory, pop_stack(memory));        \
+        i64 l = get_operand(memory, pop_stack(memory));        \
+        push_stack(memory, pack_i64(scope, fn(memory, l, r))); \
+        DISPATCH();                                            \
+    }
+
+#ifdef __clang__
+    #pragma clang diagnostic push
+    #pragma clang diagnostic ignored "-Wgnu-label-as-value"
+#endif
+
+static Env run_code(Memory* memory, Scope* scope) {
+    static const void* LABELS[] = {
+        [OP_PUSH] = &&op_push,
+        [OP_LOAD] = &&op_load,
+        [OP_STORE] = &&op_store,
+        [OP_DROP] = &&op_drop,
+        [OP_ADD] = &&op_add,
+        [OP_MUL] = &&op_mul,
+        [OP_CALL] = &&op_call,
+        [OP_RET] = &&op_ret,
+        [OP_VOID] = &&op_void,
+        [OP_HALT] = &&op_halt,
+    };
+    u32 pc = 0;
+    Op  op;
+    memory->len_stack = 0;
+    memory->len_frames = 0;
+    push_root(memory, &scope);
+    DISPATCH();
+op_push: {
+    push_stack(memory,
+               (Env){
+                   .scope = scope,
+                   .expr = &memory->nodes[op.node],
+               });
+    DISPATCH();
+}
+op_load: {
+    Env* slot = get_slot(scope, memory->nodes[op.node].body.as_ident.address);
+    FAIL_IF(!slot->scope);
+    push_stack(memory, *slot);
+    DISPATCH();
+}
+op_store: {
+    Env env = pop_stack(memory);
+    *get_slot(scope, memory->nodes[op.node].body.as_ident.address) = env;
+    push_stack(memory,
+               (Env){
+                   .scope = scope,
+                   .expr = NULL,
+               });
+    DISPATCH();
+}
+op_drop: {
+    pop_stack(memory);
+    DISPATCH();
+}
+op_add: {
+    BINOP_I64(add_i64);
+}
+op_mul: {
+    BINOP_I64(mul_i64);
+}
+op_call: {
+    Env func = pop_stack(memory);
+    Env arg = {
+        .scope = scope,
+        .expr = &memory->nodes[op.node],
+    };
+    FAIL_IF(is_i64(func));
+    switch (func.expr->tag) {
+    case AST_EXPR_FN0:
+    case AST_EXPR_FN1: {
+        if (call_native(memory, func, arg, &func)) {
+            push_stack(memory, func);
+            break;
+        }
+        FAIL_IF(CAP_FRAMES <= memory->len_frames);
+        memory->frames[memory->len_frames++] = (Frame){
+            .scope = scope,
+            .pc = pc,
+        };
+        scope = push_call(memory, func, arg);
+        pc = memory->entries[get_node(memory, func.expr)];
+        EXIT_IF(pc == ENTRY_NONE);
+        break;
+    }
+    case AST_EXPR_IDENT:
+    case AST_EXPR_CALL:
+    case AST_EXPR_INTRIN:
+    case AST_EXPR_I64:
+    case AST_EXPR_VOID: {
+        push_stack(memory, eval_expr_call(memory, func, arg));
+        break;
+    }
+    default: {
+        EXIT();
+    }
+    }
+    DISPATCH();
+}
+op_ret: {
+    EXIT_IF(memory->len_frames == 0);
+    Frame frame = memory->frames[--memory->len_frames];
+    scope = frame.scope;
+    pc = frame.pc;
+    DISPATCH();
+}
+op_void: {
+    FAIL();
+}
+op_halt: {
+    EXIT_IF(memory->len_stack != 1);
+    pop_root(memory);
+    return pop_stack(memory);
+}
+}
+
+#ifdef __clang__
+    #pragma clang diagnostic pop
+#endif
+
+#undef BINOP_I64
+#undef DISPATCH
+
+typedef pthread_t       Thread;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t  Cond;
+
+typedef struct {
+    i64    value;
+    u32    index;
+    Status status;
+} Completion;
+
+typedef struct {
+    Completion completions[CAP_QUEUE];
+    u32        head;
+    u32        len;
+    Mutex      mutex;
+    Cond       not_empty;
+    Cond       not_full;
+} Queue;
+
+typedef struct {
+    Thread        workers[CAP_WORKERS];
+    u32           len_workers;
+    const String* programs;
+    u32           len;
+    u32           next;
+    Bool          stop;
+    Mutex         mutex;
+    Cond          pending;
+    Queue         queue;
+} Pool;
+
+static void push_completion(Queue* queue, Completion completion) {
+    EXIT_IF(pthread_mutex_lock(&queue->mutex));
+    while (queue->len == CAP_QUEUE) {
+        EXIT_IF(pthread_cond_wait(&queue->not_full, &queue->mutex));
+    }
+    queue->completions[(queue->head + queue->len++) % CAP_QUEUE] = completion;
+    EXIT_IF(pthread_cond_signal(&queue->not_empty));
+    EXIT_IF(pthread_mutex_unlock(&queue->mutex));
+}
+
+static Completion pop_completion(Queue* queue) {
+    EXIT_IF(pthread_mutex_lock(&queue->mutex));
+    while (queue->len == 0) {
+        EXIT_IF(pthread_cond_wait(&queue->not_empty, &queue->mutex));
+    }
+    Completion completion = queue->completions[queue->head];
+    queue->head = (queue->head + 1) % CAP_QUEUE;
+    --queue->len;
+    EXIT_IF(pthread_cond_signal(&queue->not_full));
+    EXIT_IF(pthread_mutex_unlock(&queue->mutex));
+    return completion;
+}
+
+static Status eval_program(Memory* memory, String source, i64* value) {
+    jmp_buf bail;
+    memory->stage = STATUS_LEX;
+    if (setjmp(bail)) {
+        memory->bail = NULL;
+        return memory->stage;
+    }
+    memory->bail = &bail;
+    const Token* tokens = lex(memory, source);
+    memory->stage = STATUS_PARSE;
+    const AstExpr* expr = parse_expr(memory, &tokens, 0, 0);
+    memory->stage = STATUS_RESOLVE;
+    u32 len_slots = resolve(memory, expr);
+    memory->stage = STATUS_EVAL;
+    optimize(memory, expr);
+    compile_code(memory, expr);
+    *value = get_operand(memory,
+                         run_code(memory, alloc_scope(memory, len_slots)));
+    memory->bail = NULL;
+    memory->stage = STATUS_OK;
+    return STATUS_OK;
+}
+
+static void* do_work(void* args) {
+    Pool*   pool = args;
+    Memory* memory = alloc_memory();
+    for (;;) {
+        EXIT_IF(pthread_mutex_lock(&pool->mutex));
+        while ((!pool->stop) && (pool->len <= pool->next)) {
+            EXIT_IF(pthread_cond_wait(&pool->pending, &pool->mutex));
+        }
+        if (pool->stop) {
+            EXIT_IF(pthread_mutex_unlock(&pool->mutex));
+            break;
+        }
+        u32    index = pool->next++;
+        String program = pool->programs[index];
+        EXIT_IF(pthread_mutex_unlock(&pool->mutex));
+        reset_memory(memory);
+        Completion completion = {.value = 0, .index = index};
+        completion.status = eval_program(memory, program, &completion.value);
+        push_completion(&pool->queue, completion);
+    }
+    free_memory(memory);
+    return NULL;
+}
+
+static void start_pool(Pool* pool, u32 len_workers) {
+    EXIT_IF((len_workers == 0) || (CAP_WORKERS < len_workers));
+    *pool = (Pool){
+        .len_workers = len_workers,
+        .programs = NULL,
+        .len = 0,
+        .next = 0,
+        .stop = FALSE,
+        .mutex = PTHREAD_MUTEX_INITIALIZER,
+        .pending = PTHREAD_COND_INITIALIZER,
+        .queue =
+            {
+                .head = 0,
+                .len = 0,
+                .mutex = PTHREAD_MUTEX_INITIALIZER,
+                .not_empty = PTHREAD_COND_INITIALIZER,
+                .not_full = PTHREAD_COND_INITIALIZER,
+            },
+    };
+    for (u32 i = 0; i < len_workers; ++i) {
+        EXIT_IF(pthread_create(&pool->workers[i], NULL, do_work, pool));
+    }
+}
+
+static void stop_pool(Pool* pool) {
+    EXIT_IF(pthread_mutex_lock(&pool->mutex));
+    pool->stop = TRUE;
+    EXIT_IF(pthread_cond_broadcast(&pool->pending));
+    EXIT_IF(pthread_mutex_unlock(&pool->mutex));
+    for (u32 i = 0; i < pool->len_workers; ++i) {
+        EXIT_IF(pthread_join(pool->workers[i], NULL));
+    }
+    EXIT_IF(pthread_cond_destroy(&pool->queue.not_full));
+    EXIT_IF(pthread_cond_destroy(&pool->queue.not_empty));
+    EXIT_IF(pthread_mutex_destroy(&pool->queue.mutex));
+    EXIT_IF(pthread_cond_destroy(&pool->pending));
+    EXIT_IF(pthread_mutex_destroy(&pool->mutex));
+}
+
+static void eval_batch(Pool*         pool,
+                       const String* programs,
+                       u32           len,
+                       Completion*   completions) {
+    EXIT_IF(pthread_mutex_lock(&pool->mutex));
+    EXIT_IF(pool->next < pool->len);
+    pool->programs = programs;
+    pool->len = len;
+    pool->next = 0;
+    EXIT_IF(pthread_cond_broadcast(&pool->pending));
+    EXIT_IF(pthread_mutex_unlock(&pool->mutex));
+    for (u32 i = 0; i < len; ++i) {
+        Completion completion = pop_completion(&pool->queue);
+        completions[completion.index] = completion;
+    }
+}
+
+static const char SOURCE[] = "x = 1; y = x;\n"
+                             "f0 = (\\ ->\n"
+                             "    i = 0;\n"
+                             "    f1 = (\\ -> i = i + y; i);\n"
+                             "    f4 = f1;\n"
+                             "    f4);\n"
+                             "f3 = f0;\n"
+                             "f2 = f3 _;\n"
+                             "f2 _;\n"
+                             "f2 _\n";
+
+static const char SOURCE_CALLS[] = "i = 0;\n"
+                                   "f = (\\ -> i = i + 1);\n"
+                                   "g = (\\ -> f _; f _; f _; f _);\n"
+                                   "h = (\\ -> g _; g _; g _; g _);\n"
+                                   "k = (\\ -> h _; h _; h _; h _);\n"
+                                   "k _;\n"
+                                   "i\n";
+
+static const char SOURCE_NATIVE[] = "f = (\\x -> y = x * x; y + x);\n"
+                                    "f 1 + f 2 + f 3 + f 4\n";
+
+static const char SOURCE_CAPTURE[] = "g = (\\p -> h = (\\ -> p = 5); p);\n"
+                                     "g 3\n";
+
+static const char SOURCE_SCOPE[] = "f = (\\ -> y = 2; h = (\\ -> y); h);\n"
+                                   "k = f _;\n"
+                                   "y = 7;\n"
+                                   "k _ + (f _) _ * 10 + y * 100\n";
+
+static const char SOURCE_UTF8[] = "\xCE\xBB = (\\\xC3\xA9t\xC3\xA9 -> "
+                                  "\xC3\xA9t\xC3\xA9 * \xC3\xA9t\xC3\xA9);\n"
+                                  "\xCE\xBB 7\n";
+
+i32 main(i32 argc, const char** argv) {
+    if (1 < argc) {
+        Memory* memory = alloc_memory();
+        i32     status = OK;
+        for (i32 i = 1; i < argc; ++i) {
+            reset_memory(memory);
+            i64 value;
+            String source = read_source(memory, argv[i]);
+            if (eval_program(memory, source, &value) != STATUS_OK) {
+                status = ERROR;
+                continue;
+            }
+            printf("%ld\n", value);
+        }
+        free_memory(memory);
+        return status;
+    }
+    printf("\n"
+           "sizeof(Token)       : %zu\n"
            "sizeof(Intrinsic)   : %zu\n"
            "sizeof(AstExpr)     : %zu\n"
            "sizeof(Env)         : %zu\n"
-           "sizeof(Var)         : %zu\n"
+           "sizeof(Address)     : %zu\n"
            "sizeof(Scope)       : %zu\n"
            "sizeof(Memory)      : %zu\n"
            "\n",
@@ -772,18 +2649,272 @@ i32 main(void) {
            sizeof(Intrinsic),
            sizeof(AstExpr),
            sizeof(Env),
-           sizeof(Var),
+           sizeof(Address),
            sizeof(Scope),
            sizeof(Memory));
     Memory* memory = alloc_memory();
-    print_tokens(TOKENS);
-    const Token*   tokens = TOKENS;
+    const Token* tokens = lex(memory, STRING(SOURCE));
+    print_tokens(memory, tokens);
     const AstExpr* expr = parse_expr(memory, &tokens, 0, 0);
-    print_expr(expr);
+    print_expr(memory, expr);
     putchar('\n');
-    print_expr(
-        eval_expr(memory, (Env){.scope = alloc_scope(memory), .expr = expr})
-            .expr);
+    u32 len_slots = resolve(memory, expr);
+    u32 len_nodes = memory->len_nodes;
+    Env env = eval_expr(
+        memory,
+        (Env){.scope = alloc_scope(memory, len_slots), .expr = expr});
+    printf("%ld\n", get_i64(env));
+    EXIT_IF(memory->len_konts != 0);
+    optimize(memory, expr);
+    print_expr(memory, expr);
     putchar('\n');
+    Env optimized = eval_expr(
+        memory,
+        (Env){.scope = alloc_scope(memory, len_slots), .expr = expr});
+    printf("%ld\n", get_i64(optimized));
+    EXIT_IF(get_i64(env) != get_i64(optimized));
+    memory->profiling = TRUE;
+    Env profiled = eval_expr(
+        memory,
+        (Env){.scope = alloc_scope(memory, len_slots), .expr = expr});
+    memory->profiling = FALSE;
+    print_profile(memory);
+    print_folded(memory);
+    EXIT_IF(get_i64(env) != get_i64(profiled));
+    EXIT_IF(memory->len_samples != 0);
+    EXIT_IF(memory->path != 0);
+    EXIT_IF(memory->profiles[get_node(memory, expr)].count != 1);
+    compile_code(memory, expr);
+    print_code(memory);
+    Env result = run_code(memory, alloc_scope(memory, len_slots));
+    printf("%ld\n", get_i64(result));
+    EXIT_IF(get_i64(env) != get_i64(result));
+    EXIT_IF(memory->len_nodes != len_nodes);
+    EXIT_IF(get_i64(pack_i64(NULL, -456)) != -456);
+    EXIT_IF(!is_i64(pack_i64(NULL, 0)));
+    {
+        memory = alloc_memory();
+        tokens = lex(memory, STRING(SOURCE_CALLS));
+        print_tokens(memory, tokens);
+        expr = parse_expr(memory, &tokens, 0, 0);
+        len_slots = resolve(memory, expr);
+        optimize(memory, expr);
+        env = eval_expr(
+            memory,
+            (Env){.scope = alloc_scope(memory, len_slots), .expr = expr});
+        printf("%ld\n", get_i64(env));
+        EXIT_IF(get_i64(env) != 64);
+        compile_code(memory, expr);
+        result = run_code(memory, alloc_scope(memory, len_slots));
+        printf("%ld\n", get_i64(result));
+        EXIT_IF(get_i64(result) != 64);
+    }
+    {
+        memory = alloc_memory();
+        tokens = lex(memory, STRING(SOURCE_NATIVE));
+        print_tokens(memory, tokens);
+        expr = parse_expr(memory, &tokens, 0, 0);
+        len_slots = resolve(memory, expr);
+        optimize(memory, expr);
+        env = eval_expr(
+            memory,
+            (Env){.scope = alloc_scope(memory, len_slots), .expr = expr});
+        printf("%ld\n", get_i64(env));
+        EXIT_IF(get_i64(env) != 40);
+        EXIT_IF(memory->len_jit == 0);
+        compile_code(memory, expr);
+        result = run_code(memory, alloc_scope(memory, len_slots));
+        printf("%ld\n", get_i64(result));
+        EXIT_IF(get_i64(result) != 40);
+    }
+    {
+        memory = alloc_memory();
+        tokens = lex(memory, STRING(SOURCE_CAPTURE));
+        expr = parse_expr(memory, &tokens, 0, 0);
+        len_slots = resolve(memory, expr);
+        env = eval_expr(
+            memory,
+            (Env){.scope = alloc_scope(memory, len_slots), .expr = expr});
+        EXIT_IF(get_i64(env) != 3);
+        optimize(memory, expr);
+        print_expr(memory, expr);
+        putchar('\n');
+        optimized = eval_expr(
+            memory,
+            (Env){.scope = alloc_scope(memory, len_slots), .expr = expr});
+        printf("%ld\n", get_i64(optimized));
+        EXIT_IF(get_i64(optimized) != 3);
+    }
+    {
+        memory = alloc_memory();
+        tokens = lex(memory, STRING(SOURCE_SCOPE));
+        expr = parse_expr(memory, &tokens, 0, 0);
+        len_slots = resolve(memory, expr);
+        env = eval_expr(
+            memory,
+            (Env){.scope = alloc_scope(memory, len_slots), .expr = expr});
+        printf("%ld\n", get_i64(env));
+        EXIT_IF(get_i64(env) != 722);
+        optimize(memory, expr);
+        optimized = eval_expr(
+            memory,
+            (Env){.scope = alloc_scope(memory, len_slots), .expr = expr});
+        EXIT_IF(get_i64(optimized) != 722);
+        compile_code(memory, expr);
+        result = run_code(memory, alloc_scope(memory, len_slots));
+        EXIT_IF(get_i64(result) != 722);
+    }
+    {
+        const String programs[] = {
+            STRING(SOURCE),
+            STRING(SOURCE_CALLS),
+            STRING(SOURCE_NATIVE),
+            STRING(SOURCE),
+            STRING(SOURCE_CALLS),
+            STRING(SOURCE_NATIVE),
+            STRING(SOURCE),
+            STRING(SOURCE_CALLS),
+            STRING(SOURCE_NATIVE),
+        };
+        const String failures[] = {
+            STRING("x = 4611686018427387904; x"),
+            STRING(SOURCE_NATIVE),
+            STRING("(x = 1"),
+            STRING(SOURCE_CALLS),
+            STRING("x = y"),
+            STRING(SOURCE),
+            STRING("f = (\\x -> x + 1); g = (\\ -> 2); f (g _ + 1)"),
+            STRING(SOURCE_NATIVE),
+            STRING("x = 4611686018427387903; x + x"),
+            STRING("f = (\\x -> f x); f 1"),
+            STRING(SOURCE_CALLS),
+            STRING("f = (\\x -> x _); f 3"),
+        };
+        Completion completions[sizeof(failures) / sizeof(failures[0])];
+        Pool       pool;
+        start_pool(&pool, 4);
+        eval_batch(&pool,
+                   programs,
+                   sizeof(programs) / sizeof(programs[0]),
+                   completions);
+        for (u32 i = 0; i < (sizeof(programs) / sizeof(programs[0])); ++i) {
+            printf("%ld ", completions[i].value);
+            EXIT_IF(completions[i].status != STATUS_OK);
+            EXIT_IF(completions[i].value != ((const i64[]){2, 64, 40})[i % 3]);
+        }
+        putchar('\n');
+        eval_batch(&pool,
+                   failures,
+                   sizeof(failures) / sizeof(failures[0]),
+                   completions);
+        for (u32 i = 0; i < (sizeof(failures) / sizeof(failures[0])); ++i) {
+            EXIT_IF(completions[i].status !=
+                    ((const Status[]){
+                        STATUS_LEX,
+                        STATUS_OK,
+                        STATUS_PARSE,
+                        STATUS_OK,
+                        STATUS_RESOLVE,
+                        STATUS_OK,
+                        STATUS_EVAL,
+                        STATUS_OK,
+                        STATUS_EVAL,
+                        STATUS_EVAL,
+                        STATUS_OK,
+                        STATUS_EVAL,
+                    })[i]);
+        }
+        EXIT_IF(completions[1].value != 40);
+        EXIT_IF(completions[3].value != 64);
+        EXIT_IF(completions[5].value != 2);
+        EXIT_IF(completions[7].value != 40);
+        EXIT_IF(completions[10].value != 64);
+        stop_pool(&pool);
+    }
+    {
+        memory = alloc_memory();
+        tokens = lex(memory, STRING("x = 4611686018427387903; x"));
+        EXIT_IF(tokens[2].body.as_i64 != LITERAL_MAX);
+        expr = parse_expr(memory, &tokens, 0, 0);
+        len_slots = resolve(memory, expr);
+        env = eval_expr(
+            memory,
+            (Env){.scope = alloc_scope(memory, len_slots), .expr = expr});
+        EXIT_IF(get_i64(env) != LITERAL_MAX);
+        compile_code(memory, expr);
+        result = run_code(memory, alloc_scope(memory, len_slots));
+        EXIT_IF(get_i64(result) != LITERAL_MAX);
+        printf("%ld\n", get_i64(result));
+    }
+    {
+        memory = alloc_memory();
+        tokens = lex(memory,
+                     STRING("f = (\\x -> x * x);\n"
+                            "f 2; f 2;\n"
+                            "f 2147483647 + 2147483647 + 2147483647\n"));
+        expr = parse_expr(memory, &tokens, 0, 0);
+        len_slots = resolve(memory, expr);
+        env = eval_expr(
+            memory,
+            (Env){.scope = alloc_scope(memory, len_slots), .expr = expr});
+        EXIT_IF(get_i64(env) != LITERAL_MAX);
+        EXIT_IF(add_i64(memory, LITERAL_MIN, LITERAL_MAX) != -1);
+        EXIT_IF(mul_i64(memory, -2147483648, 2147483648) != LITERAL_MIN);
+        u32 native = NATIVE_NONE;
+        for (u32 i = 0; i < memory->len_nodes; ++i) {
+            if (memory->natives[i] < NATIVE_SKIP) {
+                native = memory->natives[i];
+            }
+        }
+        EXIT_IF(native == NATIVE_NONE);
+        JitFn fn = (JitFn)(void*)&memory->jit[native];
+        EXIT_IF(fn((i64[CAP_NAMES]){2147483647}) != 4611686014132420609);
+        EXIT_IF(fn((i64[CAP_NAMES]){2147483648}) != NATIVE_OVERFLOW);
+        EXIT_IF(fn((i64[CAP_NAMES]){3037000500}) != NATIVE_OVERFLOW);
+        EXIT_IF(fn((i64[CAP_NAMES]){-2147483648}) != NATIVE_OVERFLOW);
+    }
+    {
+        memory = alloc_memory();
+        tokens = lex(memory, STRING("x = 2147483647; x * x"));
+        expr = parse_expr(memory, &tokens, 0, 0);
+        resolve(memory, expr);
+        optimize(memory, expr);
+        print_expr(memory, expr);
+        putchar('\n');
+        EXIT_IF(expr->tag != AST_EXPR_I64);
+        EXIT_IF(expr->body.as_i64 != 4611686014132420609);
+        tokens = lex(memory, STRING("x = 3037000500; x * x"));
+        expr = parse_expr(memory, &tokens, 0, 0);
+        resolve(memory, expr);
+        optimize(memory, expr);
+        print_expr(memory, expr);
+        putchar('\n');
+        EXIT_IF(expr->tag != AST_EXPR_CALL);
+        tokens = lex(memory, STRING("x = 4611686018427387903; x + x"));
+        expr = parse_expr(memory, &tokens, 0, 0);
+        resolve(memory, expr);
+        optimize(memory, expr);
+        print_expr(memory, expr);
+        putchar('\n');
+        EXIT_IF(expr->tag != AST_EXPR_CALL);
+    }
+    {
+        memory = alloc_memory();
+        tokens = lex(memory, STRING(SOURCE_UTF8));
+        print_tokens(memory, tokens);
+        EXIT_IF(memory->len_symbols != 2);
+        EXIT_IF(tokens[4].body.as_symbol != tokens[6].body.as_symbol);
+        EXIT_IF(tokens[4].body.as_symbol !=
+                intern(memory, STRING("\xC3\xA9t\xC3\xA9")));
+        EXIT_IF(get_utf8_len((const u8*)"\xC0\xAF", 2) != 0);
+        EXIT_IF(get_utf8_len((const u8*)"\xED\xA0\x80", 3) != 0);
+        EXIT_IF(get_utf8_len((const u8*)"\xF0\x9F\x98", 3) != 0);
+        EXIT_IF(get_utf8_len((const u8*)"\xF0\x9F\x98\x80", 4) != 4);
+        memory->len_tokens = 0;
+        i64    value;
+        Status status = eval_program(memory, STRING(SOURCE_UTF8), &value);
+        EXIT_IF(status != STATUS_OK);
+        EXIT_IF(value != 49);
+    }
     return OK;
 }
@@ -1,11 +1,23 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
 
-typedef uint8_t u8;
+/* NOTE:
+ *  $ runc src/regex.c bench
+ */
 
-#define STATE_CAP 22
-#define STACK_CAP 12
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef double f64;
+
+#define STATE_CAP 4096
+#define STACK_CAP STATE_CAP
 
 #define OP_CONCAT       '.'
 #define OP_EITHER       '|'
@@ -31,6 +43,7 @@ typedef struct State State;
 struct State {
     State*    next;
     State*    next_split;
+    u32       generation;
     StateType type;
     char      token;
     Bool      end;
@@ -46,19 +59,18 @@ typedef struct {
     Link   link_stack[STACK_CAP];
     State* state_stack_a[STACK_CAP];
     State* state_stack_b[STACK_CAP];
-    State* state_stack_c[STACK_CAP];
-    State* state_stack_d[STACK_CAP];
-    u8     state_len;
+    u32    generation;
+    u16    state_len;
 } Memory;
 
 typedef struct {
     Link* links;
-    u8    len;
+    u16   len;
 } LinkStack;
 
 typedef struct {
     State** states;
-    u8      len;
+    u16     len;
 } StateStack;
 
 static State* state_new(Memory* memory) {
@@ -69,6 +81,7 @@ static State* state_new(Memory* memory) {
     State* state = &memory->states[memory->state_len++];
     state->next = NULL;
     state->next_split = NULL;
+    state->generation = 0;
     state->type = EPSILON;
     state->token = '\0';
     state->end = FALSE;
@@ -179,6 +192,7 @@ static void set_one_or_many(Memory* memory, LinkStack* stack) {
 static Link get_nfa(Memory* memory, const char* postfix_expr) {
     /* NOTE: See `https://swtch.com/~rsc/regexp/regexp1.html`. */
     memory->state_len = 0;
+    memory->generation = 0;
     LinkStack stack = {
         .links = memory->link_stack,
         .len = 0,
@@ -220,19 +234,37 @@ static Link get_nfa(Memory* memory, const char* postfix_expr) {
     return link;
 }
 
-#define PUSH(stack, state)                 \
-    {                                      \
-        if (STACK_CAP <= stack.len) {      \
-            PRINT_ERROR;                   \
-            exit(EXIT_FAILURE);            \
-        }                                  \
-        stack.states[stack.len++] = state; \
+/* NOTE: Rather than keeping a list of visited states around (and scanning
+ * it each time a state is reached), every `State` is stamped with the
+ * generation it was last pushed in; bumping `Memory.generation` then clears
+ * all the marks at once.
+ */
+static void next_generation(Memory* memory) {
+    if (++memory->generation == 0) {
+        for (u16 i = 0; i < memory->state_len; ++i) {
+            memory->states[i].generation = 0;
+        }
+        memory->generation = 1;
+    }
+}
+
+#define PUSH(stack, state)                             \
+    {                                                  \
+        if (state->generation != memory->generation) { \
+            if (STACK_CAP <= stack.len) {              \
+                PRINT_ERROR;                           \
+                exit(EXIT_FAILURE);                    \
+            }                                          \
+            state->generation = memory->generation;    \
+            stack.states[stack.len++] = state;         \
+        }                                              \
     }
 
 static Bool get_empty_match(Memory* memory, State* state) {
     if (state->type != EPSILON) {
         return FALSE;
     }
+    next_generation(memory);
     StateStack stack = {
         .states = memory->state_stack_a,
         .len = 0,
@@ -255,17 +287,6 @@ static Bool get_empty_match(Memory* memory, State* state) {
     return FALSE;
 }
 
-#undef PUSH
-
-#define PUSH(stack, state)                 \
-    {                                      \
-        if (STACK_CAP <= stack.len) {      \
-            PRINT_ERROR;                   \
-            exit(EXIT_FAILURE);            \
-        }                                  \
-        stack.states[stack.len++] = state; \
-    }
-
 static Bool get_match(Memory* memory, Link link, const char* string) {
     char token = *string;
     if (token == '\0') {
@@ -275,68 +296,42 @@ static Bool get_match(Memory* memory, Link link, const char* string) {
         .states = memory->state_stack_a,
         .len = 0,
     };
-    StateStack stack_buffer = {
-        .states = memory->state_stack_b,
-        .len = 0,
-    };
     StateStack stack_tokens = {
-        .states = memory->state_stack_c,
-        .len = 0,
-    };
-    StateStack stack_visited = {
-        .states = memory->state_stack_d,
+        .states = memory->state_stack_b,
         .len = 0,
     };
+    next_generation(memory);
     PUSH(stack_all, link.first);
     while (token != '\0') {
-        for (;;) {
-            for (u8 i = 0; i < stack_all.len; ++i) {
-                State* state = stack_all.states[i];
-                Bool   visited = FALSE;
-                for (u8 j = 0; j < stack_visited.len; ++j) {
-                    if (stack_visited.states[j] == state) {
-                        visited = TRUE;
-                        break;
-                    }
-                }
-                if (visited) {
-                    continue;
-                }
-                switch (state->type) {
-                case EPSILON: {
-                    if (state->next != NULL) {
-                        PUSH(stack_buffer, state->next);
-                    }
-                    if (state->next_split != NULL) {
-                        PUSH(stack_buffer, state->next_split);
-                    }
-                    break;
-                }
-                case TOKEN: {
-                    PUSH(stack_tokens, state);
-                    break;
-                }
-                default: {
+        /* NOTE: Each state is pushed at most once per generation, so neither
+         * stack can hold more than `Memory.state_len` states.
+         */
+        while (stack_all.len != 0) {
+            State* state = stack_all.states[--stack_all.len];
+            switch (state->type) {
+            case EPSILON: {
+                if (state->next != NULL) {
+                    PUSH(stack_all, state->next);
                 }
+                if (state->next_split != NULL) {
+                    PUSH(stack_all, state->next_split);
                 }
-                PUSH(stack_visited, state);
+                break;
             }
-            if (stack_buffer.len == 0) {
+            case TOKEN: {
+                stack_tokens.states[stack_tokens.len++] = state;
                 break;
             }
-            State** swap = stack_all.states;
-            stack_all.states = stack_buffer.states;
-            stack_all.len = stack_buffer.len;
-            stack_buffer.states = swap;
-            stack_buffer.len = 0;
+            default: {
+            }
+            }
         }
         if (stack_tokens.len == 0) {
             return FALSE;
         }
-        stack_all.len = 0;
-        stack_visited.len = 0;
+        next_generation(memory);
         char peek = *++string;
-        for (u8 i = 0; i < stack_tokens.len; ++i) {
+        for (u16 i = 0; i < stack_tokens.len; ++i) {
             State* state = stack_tokens.states[i];
             if ((token == state->token) && (state->next != NULL)) {
                 if (peek == '\0') {
@@ -390,7 +385,251 @@ static u8 TESTS_FAILED = 0;
         }                                                              \
     }
 
-int main(void) {
+#define NANO_PER_SECOND 1000000000lu
+#define BENCH_NANO      (NANO_PER_SECOND / 20)
+#define BENCH_SEED      0x2545F491u
+
+#define CAP_CORPUS (1lu << 20)
+#define CAP_LINES  (CAP_CORPUS / 16)
+#define CAP_LABEL  64
+#define CAP_EXPR   (1 << 9)
+
+#define LEN_ARRAY(array) (sizeof(array) / sizeof(array[0]))
+
+#define NO_INT_SAN __attribute__((no_sanitize("integer")))
+
+typedef struct timespec Time;
+typedef struct rusage   Usage;
+
+typedef struct {
+    char        chars[CAP_CORPUS];
+    const char* lines[CAP_LINES];
+    u64         len;
+    u32         len_lines;
+} Corpus;
+
+typedef struct {
+    u64 bytes;
+    u64 nanoseconds;
+    u64 iterations;
+    u64 matches;
+} Bench;
+
+static u64 get_monotonic(void) {
+    Time time;
+    if (clock_gettime(CLOCK_MONOTONIC, &time)) {
+        PRINT_ERROR;
+        exit(EXIT_FAILURE);
+    }
+    return (((u64)time.tv_sec) * NANO_PER_SECOND) + ((u64)time.tv_nsec);
+}
+
+NO_INT_SAN static u32 xor_shift_32(u32* state) {
+    u32 x = *state;
+    x ^= x << 13u;
+    x ^= x >> 17u;
+    x ^= x << 5u;
+    *state = x;
+    return x;
+}
+
+/* NOTE: This is the same corpus `src/regex_vm.c` generates for its own
+ * benchmark, but with lines terminated by `\0` rather than `\n`, so both
+ * engines should report the same number of matches.
+ */
+static void set_corpus(Corpus* corpus, u64 len, u32 density) {
+    if (CAP_CORPUS < len) {
+        PRINT_ERROR;
+        exit(EXIT_FAILURE);
+    }
+    u32 rng = BENCH_SEED;
+    corpus->len = 0;
+    corpus->len_lines = 0;
+    while (corpus->len < len) {
+        u64 len_line = 16 + (xor_shift_32(&rng) % 32);
+        if (len < (corpus->len + len_line + 1)) {
+            break;
+        }
+        if (CAP_LINES <= corpus->len_lines) {
+            PRINT_ERROR;
+            exit(EXIT_FAILURE);
+        }
+        char* line = &corpus->chars[corpus->len];
+        if ((xor_shift_32(&rng) % 1024) < density) {
+            u64 len_e = 1 + (xor_shift_32(&rng) % 8);
+            len_line = 0;
+            line[len_line++] = 'n';
+            for (u64 i = 0; i < len_e; ++i) {
+                line[len_line++] = 'e';
+            }
+            line[len_line++] = 'd';
+            line[len_line++] = 'l';
+            line[len_line++] = 'e';
+        } else {
+            for (u64 i = 0; i < len_line; ++i) {
+                line[i] = "abcd "[xor_shift_32(&rng) % 5];
+            }
+        }
+        corpus->lines[corpus->len_lines++] = line;
+        line[len_line] = '\0';
+        corpus->len += len_line + 1;
+    }
+}
+
+static Bench bench_corpus(Memory* memory, Link link, Corpus* corpus) {
+    Bench bench = {0};
+    u64   start = get_monotonic();
+    do {
+        bench.matches = 0;
+        for (u32 i = 0; i < corpus->len_lines; ++i) {
+            if (get_match(memory, link, corpus->lines[i])) {
+                ++bench.matches;
+            }
+        }
+        bench.bytes += corpus->len;
+        ++bench.iterations;
+        bench.nanoseconds = get_monotonic() - start;
+    } while (bench.nanoseconds < BENCH_NANO);
+    return bench;
+}
+
+static Bench bench_string(Memory* memory, Link link, const char* string) {
+    Bench bench = {0};
+    u64   start = get_monotonic();
+    do {
+        bench.matches = get_match(memory, link, string) ? 1 : 0;
+        bench.bytes += strlen(string);
+        ++bench.iterations;
+        bench.nanoseconds = get_monotonic() - start;
+    } while (bench.nanoseconds < BENCH_NANO);
+    return bench;
+}
+
+static Bench bench_compile(Memory* memory, const char* postfix_expr) {
+    Bench bench = {0};
+    u64   start = get_monotonic();
+    do {
+        get_nfa(memory, postfix_expr);
+        bench.bytes += strlen(postfix_expr);
+        ++bench.iterations;
+        bench.nanoseconds = get_monotonic() - start;
+    } while (bench.nanoseconds < BENCH_NANO);
+    return bench;
+}
+
+static void show_bench(const char* engine, const char* label, Bench bench) {
+    f64 seconds = (f64)bench.nanoseconds / (f64)NANO_PER_SECOND;
+    printf("%-8s %-24s %12lu %12lu %12.2f %8lu\n",
+           engine,
+           label,
+           bench.bytes / bench.iterations,
+           bench.nanoseconds / bench.iterations,
+           ((f64)bench.bytes / seconds) / (f64)(1 << 20),
+           bench.matches);
+}
+
+/* NOTE: These are the postfix forms of `ne+dle`, `(a|b)(c|d)+e`, and
+ * `((a|b)*c|d?e)+f`.
+ */
+static const char* BENCH_EXPRS[] = {
+    "ne+.d.l.e.",
+    "ab|cd|+.e.",
+    "ab|*c.d?e.|+f.",
+};
+
+static const u64 BENCH_LENS[] = {
+    1lu << 12,
+    1lu << 16,
+    1lu << 20,
+};
+
+static const u32 BENCH_DENSITIES[] = {0, 8, 512};
+
+static const u8 BENCH_PATHOLOGICAL[] = {4, 8, 16, 32, 64};
+
+/* NOTE: `get_match()` is an anchored match over a whole line, whereas
+ * `src/regex_vm.c` searches each line for a match anywhere within it; lines
+ * that do not match are usually rejected here after their first byte.
+ */
+static void bench(void) {
+    Memory* memory = calloc(1, sizeof(Memory));
+    Corpus* corpus = calloc(1, sizeof(Corpus));
+    if ((memory == NULL) || (corpus == NULL)) {
+        PRINT_ERROR;
+        exit(EXIT_FAILURE);
+    }
+    char label[CAP_LABEL];
+    printf("%-8s %-24s %12s %12s %12s %8s\n",
+           "engine",
+           "bench",
+           "bytes/iter",
+           "ns/iter",
+           "MB/s",
+           "matches");
+    for (u32 i = 0; i < LEN_ARRAY(BENCH_EXPRS); ++i) {
+        show_bench("compile",
+                   BENCH_EXPRS[i],
+                   bench_compile(memory, BENCH_EXPRS[i]));
+    }
+    Link link = get_nfa(memory, BENCH_EXPRS[0]);
+    for (u32 i = 0; i < LEN_ARRAY(BENCH_LENS); ++i) {
+        for (u32 j = 0; j < LEN_ARRAY(BENCH_DENSITIES); ++j) {
+            set_corpus(corpus, BENCH_LENS[i], BENCH_DENSITIES[j]);
+            snprintf(label,
+                     CAP_LABEL,
+                     "corpus %lu %u/1024",
+                     BENCH_LENS[i],
+                     BENCH_DENSITIES[j]);
+            show_bench("nfa", label, bench_corpus(memory, link, corpus));
+        }
+    }
+    for (u32 i = 0; i < LEN_ARRAY(BENCH_PATHOLOGICAL); ++i) {
+        u8   n = BENCH_PATHOLOGICAL[i];
+        char postfix_expr[CAP_EXPR];
+        char string[CAP_EXPR];
+        u16  len = 0;
+        if (CAP_EXPR <= (5 * n)) {
+            PRINT_ERROR;
+            exit(EXIT_FAILURE);
+        }
+        for (u8 j = 0; j < n; ++j) {
+            postfix_expr[len++] = 'a';
+            postfix_expr[len++] = '?';
+            if (j != 0) {
+                postfix_expr[len++] = '.';
+            }
+        }
+        for (u8 j = 0; j < n; ++j) {
+            postfix_expr[len++] = 'a';
+            postfix_expr[len++] = '.';
+            string[j] = 'a';
+        }
+        postfix_expr[len] = '\0';
+        string[n] = '\0';
+        snprintf(label, CAP_LABEL, "(a?)^%hhu a^%hhu", n, n);
+        Link link_n = get_nfa(memory, postfix_expr);
+        show_bench("nfa", label, bench_string(memory, link_n, string));
+    }
+    Usage usage;
+    if (getrusage(RUSAGE_SELF, &usage)) {
+        PRINT_ERROR;
+        exit(EXIT_FAILURE);
+    }
+    printf("\nsizeof(Memory) : %zu\n"
+           "sizeof(Corpus) : %zu\n"
+           "peak memory    : %ld KiB\n",
+           sizeof(Memory),
+           sizeof(Corpus),
+           usage.ru_maxrss);
+    free(corpus);
+    free(memory);
+}
+
+int main(int argc, const char** argv) {
+    if ((1 < argc) && (!strcmp(argv[1], "bench"))) {
+        bench();
+        return EXIT_SUCCESS;
+    }
     printf("sizeof(State)     : %zu\n"
            "sizeof(u8)        : %zu\n"
            "sizeof(StateType) : %zu\n"
@@ -588,6 +827,19 @@ int main(void) {
     TEST("abcdef|||||", "g", FALSE);
     TEST("abcdef|||||", "h", FALSE);
     TEST("abcdef|||||", "", FALSE);
+    TEST("a**", "", TRUE);
+    TEST("a**", "aaa", TRUE);
+    TEST("a**b.", "aab", TRUE);
+    TEST("a?a?.a?.a?.aa.a.a..", "aaaa", TRUE);
+    TEST("a?a?.a?.a?.aa.a.a..", "aaaaaaaa", TRUE);
+    TEST("a?a?.a?.a?.aa.a.a..", "aaa", FALSE);
+    TEST("a?a?.a?.a?.aa.a.a..", "aaaaaaaaa", FALSE);
+    TEST("abcdefghijklmnopqrstuvwxyz|||||||||||||||||||||||||*",
+         "thequickbrownfoxjumpsoverthelazydog",
+         TRUE);
+    TEST("abcdefghijklmnopqrstuvwxyz|||||||||||||||||||||||||*",
+         "thequickbrownfoxjumpsoverthelazydog!",
+         FALSE);
     if (0 < TESTS_FAILED) {
         printf("\n");
     }
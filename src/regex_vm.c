@@ -1,12 +1,31 @@
 #include <assert.h>
+#include <immintrin.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
 
 // NOTE: See `https://swtch.com/~rsc/regexp/regexp2.html`.
 // NOTE: See `https://pubs.opengroup.org/onlinepubs/9699919799/basedefs/V1_chap09.html#tag_09_04_08`.
 // NOTE: See `https://matklad.github.io/2020/04/13/simple-but-powerful-pratt-parsing.html`.
+// NOTE: See `https://swtch.com/~rsc/regexp/regexp3.html`.
+// NOTE: See `http://0x80.pl/articles/simd-strfind.html`.
+// NOTE: See `https://www.felixcloutier.com/x86/`.
+// NOTE: See `https://www.dcc.uchile.cl/~gnavarro/ps/jea02.pdf`.
+
+/* NOTE:
+ *  $ runc src/regex_vm.c bench
+ *  $ runc src/regex_vm.c lexer switch 'if' 0 'i(f|n)*' 1 ' +' 2 > lexer.c
+ *  $ runc src/regex_vm.c lexer table 'if' 0 'i(f|n)*' 1 ' +' 2 > lexer.c
+ *  $ runc src/regex_vm.c save 'ne+dle' > needle.bin
+ */
 
 #define CAP_TOKENS    128
 #define CAP_EXPRS     128
@@ -16,15 +35,75 @@
 #define CAP_THREADS   512
 #define CAP_STRING    64
 #define CAP_FLAGS     (sizeof(u64) * CAP_INSTS)
+#define CAP_DFA       128
+#define CAP_BYTES     256
+#define CAP_CHUNK     (1 << 12)
+#define CAP_LITERAL   32
+#define CAP_PATTERNS  64
+#define CAP_GROUPS    8
+#define CAP_SLOTS     (2 * CAP_GROUPS)
+#define CAP_CAPTURES  ((2 * CAP_INSTS) + 2)
+#define CAP_JIT       (1 << 12)
+#define CAP_POSITIONS 64
+#define CAP_FOLLOWS   (CAP_POSITIONS / 8)
+#define CAP_WORKERS   16
+#define CAP_SLICE     (1lu << 20)
+#define CAP_OVERLAP   CAP_SLICE
+#define CAP_PENDING   64
+#define CAP_COUNTERS  16
+#define CAP_CACHE     16
+#define CAP_CACHE_KEY 256
+#define CAP_PROGRAM   (1 << 15)
+
+#define DFA_UNKNOWN 0xFFFF
+#define SLOT_NONE   0xFFFFFFFFFFFFFFFFlu
+#define OFFSET_NONE 0xFFFFFFFFFFFFFFFFlu
+#define RULE_NONE   0xFFFF
+#define RANGE_INF   0xFFFF
+#define COUNTS_ZERO 1lu
+
+#define PROGRAM_MAGIC   0x4D565852u
+#define PROGRAM_VERSION 3
+
+#define FNV_OFFSET 0xCBF29CE484222325lu
+#define FNV_PRIME  0x100000001B3lu
 
+typedef uint8_t  u8;
 typedef uint16_t u16;
+typedef uint32_t u32;
 typedef uint64_t u64;
 typedef size_t   usize;
 
+typedef atomic_uint_fast64_t u64Atomic;
+
 typedef int32_t i32;
 
+#ifdef __AVX2__
+typedef __m256i SimdBytes;
+
+    #define SIMD_WIDTH            32
+    #define SIMD_SET(char_)       _mm256_set1_epi8((char)(char_))
+    #define SIMD_LOAD(chars)      _mm256_loadu_si256((const SimdBytes*)(chars))
+    #define SIMD_EQ(a, b)         _mm256_cmpeq_epi8(a, b)
+    #define SIMD_AND(a, b)        _mm256_and_si256(a, b)
+    #define SIMD_MASK(simd_bytes) ((u32)_mm256_movemask_epi8(simd_bytes))
+#else
+typedef __m128i SimdBytes;
+
+    #define SIMD_WIDTH            16
+    #define SIMD_SET(char_)       _mm_set1_epi8((char)(char_))
+    #define SIMD_LOAD(chars)      _mm_loadu_si128((const SimdBytes*)(chars))
+    #define SIMD_EQ(a, b)         _mm_cmpeq_epi8(a, b)
+    #define SIMD_AND(a, b)        _mm_and_si128(a, b)
+    #define SIMD_MASK(simd_bytes) ((u32)_mm_movemask_epi8(simd_bytes))
+#endif
+
 #define STATIC_ASSERT _Static_assert
 
+#define LEN_ARRAY(array) (sizeof(array) / sizeof(array[0]))
+
+#define NO_INT_SAN __attribute__((no_sanitize("integer")))
+
 typedef enum {
     FALSE = 0,
     TRUE,
@@ -72,10 +151,17 @@ typedef enum {
     TOKEN_ONE_OR_MANY,
     TOKEN_LPAREN,
     TOKEN_RPAREN,
+    TOKEN_REPEAT,
     COUNT_TOKEN_TAG,
 } TokenTag;
 
 typedef struct {
+    u16 min;
+    u16 max;
+} Range;
+
+typedef struct {
+    Range    range;
     char     char_;
     TokenTag tag;
 } Token;
@@ -87,13 +173,27 @@ typedef enum {
     EXPR_ZERO_OR_ONE,
     EXPR_ZERO_OR_MANY,
     EXPR_ONE_OR_MANY,
+    EXPR_GROUP,
+    EXPR_REPEAT,
 } ExprTag;
 
 typedef struct Expr Expr;
 
+typedef struct {
+    Expr* expr;
+    u16   index;
+} Group;
+
+typedef struct {
+    Expr* expr;
+    Range range;
+} Repeat;
+
 typedef union {
-    Expr* as_expr[2];
-    char  as_char;
+    Expr*  as_expr[2];
+    Group  as_group;
+    Repeat as_repeat;
+    char   as_char;
 } ExprOp;
 
 struct Expr {
@@ -107,12 +207,17 @@ typedef enum {
     PRE_INST_CHAR,
     PRE_INST_JUMP,
     PRE_INST_SPLIT,
+    PRE_INST_SAVE,
+    PRE_INST_REPEAT,
     COUNT_PRE_INST_TAG,
 } PreInstTag;
 
 typedef union {
     u16  as_label[2];
     u16  as_line[2];
+    u16  as_id;
+    u16  as_slot;
+    u16  as_counter;
     char as_char;
 } PreInstOp;
 
@@ -126,10 +231,15 @@ typedef enum {
     INST_CHAR,
     INST_JUMP,
     INST_SPLIT,
+    INST_SAVE,
+    INST_REPEAT,
 } InstTag;
 
 typedef union {
     u16  as_line[2];
+    u16  as_id;
+    u16  as_slot;
+    u16  as_counter;
     char as_char;
 } InstOp;
 
@@ -139,45 +249,195 @@ typedef struct {
 } Inst;
 
 typedef struct {
+    u64 start;
+    u64 counts;
     u16 index;
-    u16 start;
+    u16 captures;
 } Thread;
 
 typedef struct {
-    Token   tokens[CAP_TOKENS];
-    u16     len_tokens;
-    u16     cur_tokens;
-    Expr    exprs[CAP_EXPRS];
-    u16     len_exprs;
-    PreInst pre_insts[CAP_PRE_INSTS];
-    u16     len_pre_insts;
-    u16     labels[CAP_LABELS];
-    u16     len_labels;
-    Inst    insts[CAP_INSTS];
-    u16     len_insts;
-    Thread  threads[2][CAP_THREADS];
-    u64     flags[2][CAP_INSTS];
+    u64   bytes[CAP_BYTES / 64];
+    Range range;
+} Counter;
+
+typedef struct {
+    u64 slots[CAP_SLOTS];
+    u16 refs;
+} Captures;
+
+typedef struct {
+    u64  first;
+    u64  last;
+    Bool nullable;
+} Glushkov;
+
+typedef enum {
+    ENGINE_DFA = 0,
+    ENGINE_GLUSHKOV,
+} Engine;
+
+typedef struct {
+    u64 insts;
+    u64 matches;
+} DfaState;
+
+typedef struct {
+    Token    tokens[CAP_TOKENS];
+    u16      len_tokens;
+    u16      cur_tokens;
+    Expr     exprs[CAP_EXPRS];
+    u16      len_exprs;
+    PreInst  pre_insts[CAP_PRE_INSTS];
+    u16      len_pre_insts;
+    u16      labels[CAP_LABELS];
+    u16      len_labels;
+    u16      len_groups;
+    Inst     insts[CAP_INSTS];
+    u16      len_insts;
+    Counter  counters[CAP_COUNTERS];
+    u16      len_counters;
+    Inst     reverse_insts[CAP_INSTS];
+    u16      len_reverse_insts;
+    u64      reverse_closures[CAP_INSTS];
+    u64      reverse_match_insts;
+    Bool     reverse;
+    Bool     expand_repeats;
+    Thread   threads[2][CAP_THREADS];
+    u64      flags[2][CAP_INSTS];
+    u64      counts[2][CAP_INSTS * CAP_STRING];
+    u64      closures[CAP_INSTS];
+    u64      match_insts;
+    DfaState dfa_states[CAP_DFA];
+    u16      dfa_transitions[CAP_DFA][CAP_BYTES];
+    u16      len_dfa_states;
+    u16      budget_dfa_states;
+    char     literal[CAP_LITERAL];
+    u16      len_literal;
+    Bool     literal_prefix;
+    Captures captures[CAP_CAPTURES];
+    u16      free_captures[CAP_CAPTURES];
+    u16      len_free_captures;
+    u8*      jit;
+    u32      len_jit;
+    Glushkov glushkov;
+    u64      positions[CAP_BYTES];
+    u64      follows[CAP_POSITIONS];
+    u64      follow_tables[CAP_FOLLOWS][CAP_BYTES];
+    u16      len_positions;
+    Engine   engine;
 } Memory;
 
 typedef struct {
     Thread* buffer;
     u64*    flags;
+    u64*    counts;
     u16     len;
 } Threads;
 
 typedef struct {
-    u16  start;
-    u16  end;
+    Thread buffer[CAP_THREADS];
+    u64    counts[CAP_INSTS];
+    u64    flags;
+    u16    len;
+} StreamThreads;
+
+typedef struct {
+    u64  start;
+    u64  end;
     Bool match;
 } Bounds;
 
+typedef u64 (*JitFn)(const char*, u64);
+
+typedef struct {
+    StreamThreads threads[2];
+    Bounds        result;
+    u64           offset;
+    u64           limit;
+    u8            current;
+    Bool          done;
+} Stream;
+
+typedef struct {
+    Memory*     memory;
+    const char* chars;
+    u64         len;
+    u64         len_slices;
+    u64Atomic   index;
+    u64Atomic   found;
+} Job;
+
+typedef struct {
+    Job*   job;
+    Bounds result;
+    u64    slice;
+    Bool   settled;
+} Payload;
+
+typedef struct {
+    StreamThreads threads[2];
+    Bounds        pending[CAP_PENDING];
+    Bounds        last;
+    String        string;
+    u16           len_pending;
+    u16           offset;
+    u8            current;
+    Bool          done;
+} Iterator;
+
+typedef struct {
+    u64 insts[CAP_DFA];
+    u16 transitions[CAP_DFA][CAP_BYTES];
+    u16 rules[CAP_DFA];
+    u8  classes[CAP_BYTES];
+    u16 len_states;
+    u16 len_classes;
+} Lexer;
+
+typedef struct {
+    usize offset;
+    usize size;
+    usize stride;
+    usize len;
+    u16   unit;
+} Field;
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u64 len;
+    u64 layout;
+    u16 len_insts;
+    u16 len_reverse_insts;
+    u16 len_counters;
+    u16 len_literal;
+    u16 len_positions;
+} ProgramHeader;
+
+typedef struct {
+    u8   programs[CAP_CACHE][CAP_PROGRAM];
+    u64  len_programs[CAP_CACHE];
+    char keys[CAP_CACHE][CAP_CACHE_KEY];
+    u64  hashes[CAP_CACHE];
+    u16  len_keys[CAP_CACHE];
+    u16  len;
+    u16  next;
+    u64  hits;
+    u64  misses;
+} Cache;
+
+typedef struct stat Stat;
+
 static void reset(Memory* memory) {
     memory->len_tokens = 0;
     memory->cur_tokens = 0;
     memory->len_exprs = 0;
     memory->len_pre_insts = 0;
     memory->len_labels = 0;
+    memory->len_groups = 0;
     memory->len_insts = 0;
+    memory->len_counters = 0;
+    memory->expand_repeats = FALSE;
 }
 
 static Token* alloc_token(Memory* memory) {
@@ -200,8 +460,8 @@ static Inst* alloc_inst(Memory* memory) {
     return &memory->insts[memory->len_insts++];
 }
 
-#define SET_CONCAT(memory)                                              \
-    if ((memory->len_tokens != 0) &&                                    \
+#define SET_CONCAT(memory, first)                                       \
+    if ((memory->len_tokens != first) &&                                \
         (memory->tokens[memory->len_tokens - 1].tag != TOKEN_OR) &&     \
         (memory->tokens[memory->len_tokens - 1].tag != TOKEN_CONCAT) && \
         (memory->tokens[memory->len_tokens - 1].tag != TOKEN_LPAREN))   \
@@ -210,8 +470,24 @@ static Inst* alloc_inst(Memory* memory) {
         token->tag = TOKEN_CONCAT;                                      \
     }
 
+static u16 parse_count(String string, u16 i, u16* count) {
+    u16 first = i;
+    u32 value = 0;
+    for (; (i < string.len) && ('0' <= string.chars[i]) &&
+           (string.chars[i] <= '9');
+         ++i)
+    {
+        value = (10 * value) + (u32)(string.chars[i] - '0');
+        EXIT_IF(RANGE_INF <= value);
+    }
+    EXIT_IF(i == first);
+    *count = (u16)value;
+    return i;
+}
+
 static void set_tokens(Memory* memory, String string) {
     Parens parens = {0};
+    u16    first = memory->len_tokens;
     for (u16 i = 0; i < string.len; ++i) {
         EXIT_IF(parens.open_ < parens.close_);
         switch (string.chars[i]) {
@@ -235,9 +511,26 @@ static void set_tokens(Memory* memory, String string) {
             token->tag = TOKEN_ONE_OR_MANY;
             break;
         }
+        case '{': {
+            Token* token = alloc_token(memory);
+            token->tag = TOKEN_REPEAT;
+            i = parse_count(string, (u16)(i + 1), &token->range.min);
+            token->range.max = token->range.min;
+            if ((i < string.len) && (string.chars[i] == ',')) {
+                token->range.max = RANGE_INF;
+                if (((i + 1) < string.len) && (string.chars[i + 1] != '}')) {
+                    i = parse_count(string, (u16)(i + 1), &token->range.max);
+                } else {
+                    ++i;
+                }
+            }
+            EXIT_IF((string.len <= i) || (string.chars[i] != '}'));
+            EXIT_IF(token->range.max < token->range.min);
+            break;
+        }
         case '(': {
             ++parens.open_;
-            SET_CONCAT(memory);
+            SET_CONCAT(memory, first);
             Token* token = alloc_token(memory);
             token->tag = TOKEN_LPAREN;
             break;
@@ -249,7 +542,7 @@ static void set_tokens(Memory* memory, String string) {
             break;
         }
         default: {
-            SET_CONCAT(memory);
+            SET_CONCAT(memory, first);
             Token* token = alloc_token(memory);
             token->char_ = string.chars[i];
             token->tag = TOKEN_CHAR;
@@ -293,6 +586,10 @@ static void show_token(Token token) {
         printf(" )\n");
         break;
     }
+    case TOKEN_REPEAT: {
+        printf(" {%hu,%hu}\n", token.range.min, token.range.max);
+        break;
+    }
     case COUNT_TOKEN_TAG:
     default: {
         ERROR();
@@ -352,7 +649,9 @@ static Expr* parse_expr(Memory* memory, u16 prev_binding) {
             break;
         }
         case TOKEN_LPAREN: {
-            expr = parse_expr(memory, BINDING_PAREN);
+            expr->tag = EXPR_GROUP;
+            expr->op.as_group.index = memory->len_groups++;
+            expr->op.as_group.expr = parse_expr(memory, BINDING_PAREN);
             break;
         }
         case TOKEN_CONCAT:
@@ -361,6 +660,7 @@ static Expr* parse_expr(Memory* memory, u16 prev_binding) {
         case TOKEN_ZERO_OR_MANY:
         case TOKEN_ONE_OR_MANY:
         case TOKEN_RPAREN:
+        case TOKEN_REPEAT:
         case COUNT_TOKEN_TAG:
         default: {
             ERROR();
@@ -402,6 +702,20 @@ static Expr* parse_expr(Memory* memory, u16 prev_binding) {
                         expr);
             break;
         }
+        case TOKEN_REPEAT: {
+            if (BINDING_POSTFIX < prev_binding) {
+                return expr;
+            }
+            pop_token(memory);
+            Expr* repeat = alloc_expr(memory);
+            repeat->tag = EXPR_REPEAT;
+            repeat->op.as_repeat = (Repeat){
+                .expr = expr,
+                .range = token.range,
+            };
+            expr = repeat;
+            break;
+        }
         case TOKEN_LPAREN: {
             pop_token(memory);
             expr = parse_expr(memory, BINDING_PAREN);
@@ -478,6 +792,20 @@ static void show_expr(Expr* expr, u16 n) {
         SHOW_ONE(expr, " +", n);
         break;
     }
+    case EXPR_GROUP: {
+        show_expr(expr->op.as_group.expr, n + PAD);
+        INDENT(n);
+        printf(" (%hu)\n", expr->op.as_group.index);
+        break;
+    }
+    case EXPR_REPEAT: {
+        show_expr(expr->op.as_repeat.expr, n + PAD);
+        INDENT(n);
+        printf(" {%hu,%hu}\n",
+               expr->op.as_repeat.range.min,
+               expr->op.as_repeat.range.max);
+        break;
+    }
     default: {
         ERROR();
     }
@@ -499,6 +827,33 @@ static void show_expr(Expr* expr, u16 n) {
         pre_inst->op.as_label[1] = label_1;         \
     }
 
+#define EMIT_SAVE(slot_)                            \
+    {                                               \
+        PreInst* pre_inst = alloc_pre_inst(memory); \
+        pre_inst->tag = PRE_INST_SAVE;              \
+        pre_inst->op.as_slot = (u16)(slot_);        \
+    }
+
+static Bool set_counter_bytes(Expr* expr, u64* bytes) {
+    if (!expr) {
+        return FALSE;
+    }
+    if (expr->tag == EXPR_CHAR) {
+        u8 byte = (u8)expr->op.as_char;
+        bytes[byte / 64] |= 1lu << (byte % 64);
+        return TRUE;
+    }
+    if (expr->tag == EXPR_OR) {
+        return set_counter_bytes(expr->op.as_expr[0], bytes) &&
+               set_counter_bytes(expr->op.as_expr[1], bytes);
+    }
+    return FALSE;
+}
+
+static u16 get_counter_top(Range range) {
+    return range.max == RANGE_INF ? range.min : range.max;
+}
+
 static void emit(Memory* memory, Expr* expr) {
     if (!expr) {
         return;
@@ -511,8 +866,8 @@ static void emit(Memory* memory, Expr* expr) {
         break;
     }
     case EXPR_CONCAT: {
-        emit(memory, expr->op.as_expr[0]);
-        emit(memory, expr->op.as_expr[1]);
+        emit(memory, expr->op.as_expr[memory->reverse ? 1 : 0]);
+        emit(memory, expr->op.as_expr[memory->reverse ? 0 : 1]);
         break;
     }
     case EXPR_OR: {
@@ -558,6 +913,83 @@ static void emit(Memory* memory, Expr* expr) {
         EMIT_PRE_INST_LABEL(PRE_INST_LABEL, label_1);
         break;
     }
+    case EXPR_GROUP: {
+        if (expr->op.as_group.index < CAP_GROUPS) {
+            EMIT_SAVE(2 * expr->op.as_group.index);
+        }
+        emit(memory, expr->op.as_group.expr);
+        if (expr->op.as_group.index < CAP_GROUPS) {
+            EMIT_SAVE((2 * expr->op.as_group.index) + 1);
+        }
+        break;
+    }
+    case EXPR_REPEAT: {
+        // NOTE: A one-byte `x{n,m}` becomes a single `repeat` line holding
+        // the set of iteration counts; anything else, and any repeat in a
+        // set, is expanded.
+        Repeat  repeat = expr->op.as_repeat;
+        Counter counter = {
+            .bytes = {0},
+            .range = repeat.range,
+        };
+        Bool counted = (!memory->expand_repeats) &&
+                       (get_counter_top(repeat.range) < 64);
+        if (counted && (repeat.range.max != 0) && repeat.expr &&
+            (repeat.expr->tag == EXPR_GROUP) &&
+            set_counter_bytes(repeat.expr->op.as_group.expr, counter.bytes))
+        {
+            Range range = repeat.range;
+            if (range.min != 0) {
+                --range.min;
+            }
+            if (range.max != RANGE_INF) {
+                --range.max;
+            }
+            Expr inner = {
+                .op.as_repeat.expr = repeat.expr->op.as_group.expr,
+                .op.as_repeat.range = range,
+                .tag = EXPR_REPEAT,
+            };
+            Expr last = {
+                .op.as_expr = {&inner, repeat.expr},
+                .tag = EXPR_CONCAT,
+            };
+            Expr optional = {
+                .op.as_expr = {&last, NULL},
+                .tag = EXPR_ZERO_OR_ONE,
+            };
+            emit(memory, repeat.range.min == 0 ? &optional : &last);
+            break;
+        }
+        if (counted && set_counter_bytes(repeat.expr, counter.bytes)) {
+            EXIT_IF(CAP_COUNTERS <= memory->len_counters);
+            memory->counters[memory->len_counters] = counter;
+            PreInst* pre_inst = alloc_pre_inst(memory);
+            pre_inst->tag = PRE_INST_REPEAT;
+            pre_inst->op.as_counter = memory->len_counters++;
+            break;
+        }
+        for (u16 i = 0; i < repeat.range.min; ++i) {
+            emit(memory, repeat.expr);
+        }
+        if (repeat.range.max == RANGE_INF) {
+            Expr star = {
+                .op.as_expr = {repeat.expr, NULL},
+                .tag = EXPR_ZERO_OR_MANY,
+            };
+            emit(memory, &star);
+            break;
+        }
+        u16 label = memory->len_labels++;
+        for (u16 i = repeat.range.min; i < repeat.range.max; ++i) {
+            u16 label_0 = memory->len_labels++;
+            EMIT_SPLIT(label_0, label);
+            EMIT_PRE_INST_LABEL(PRE_INST_LABEL, label_0);
+            emit(memory, repeat.expr);
+        }
+        EMIT_PRE_INST_LABEL(PRE_INST_LABEL, label);
+        break;
+    }
     default: {
         ERROR();
     }
@@ -576,7 +1008,9 @@ static void resolve_labels(Memory* memory) {
         case PRE_INST_MATCH:
         case PRE_INST_CHAR:
         case PRE_INST_JUMP:
-        case PRE_INST_SPLIT: {
+        case PRE_INST_SPLIT:
+        case PRE_INST_SAVE:
+        case PRE_INST_REPEAT: {
             ++line;
             break;
         }
@@ -613,6 +1047,7 @@ static void resolve_labels(Memory* memory) {
         case PRE_INST_MATCH: {
             Inst* inst = alloc_inst(memory);
             inst->tag = INST_MATCH;
+            inst->op.as_id = memory->pre_insts[i].op.as_id;
             break;
         }
         case PRE_INST_CHAR: {
@@ -621,6 +1056,18 @@ static void resolve_labels(Memory* memory) {
             inst->op.as_char = memory->pre_insts[i].op.as_char;
             break;
         }
+        case PRE_INST_SAVE: {
+            Inst* inst = alloc_inst(memory);
+            inst->tag = INST_SAVE;
+            inst->op.as_slot = memory->pre_insts[i].op.as_slot;
+            break;
+        }
+        case PRE_INST_REPEAT: {
+            Inst* inst = alloc_inst(memory);
+            inst->tag = INST_REPEAT;
+            inst->op.as_counter = memory->pre_insts[i].op.as_counter;
+            break;
+        }
         case COUNT_PRE_INST_TAG:
         default: {
             ERROR();
@@ -629,187 +1076,2722 @@ static void resolve_labels(Memory* memory) {
     }
 }
 
-static Expr* compile(Memory* memory, String regex) {
-    reset(memory);
-    set_tokens(memory, regex);
-    Expr* expr = parse_expr(memory, BINDING_INIT);
-    emit(memory, expr);
-    PreInst* pre_inst = alloc_pre_inst(memory);
-    pre_inst->tag = PRE_INST_MATCH;
-    resolve_labels(memory);
-    return expr;
-}
-
-#define LINE_FMT "%hu"
-
-static void show_inst(Inst inst) {
-    switch (inst.tag) {
-    case INST_MATCH: {
-        printf("\tmatch\n");
-        break;
-    }
-    case INST_CHAR: {
-        printf("\tchar\t'%c'\n", inst.op.as_char);
-        break;
-    }
-    case INST_JUMP: {
-        printf("\tjump\t" LINE_FMT "\n", inst.op.as_line[0]);
-        break;
-    }
-    case INST_SPLIT:
-        printf("\tsplit\t" LINE_FMT ",\t" LINE_FMT "\n",
-               inst.op.as_line[0],
-               inst.op.as_line[1]);
-        break;
-    default: {
-        ERROR();
-    }
-    }
-}
-
-static void show_all(Memory* memory, Expr* expr) {
-    for (u16 i = 0; i < memory->len_tokens; ++i) {
-        show_token(memory->tokens[i]);
-    }
-    printf("\n");
-    show_expr(expr, 0);
-    printf("\n");
+STATIC_ASSERT(CAP_INSTS == 64, "CAP_INSTS != 64");
+static void set_closures(Memory* memory) {
+    memory->match_insts = 0;
     for (u16 i = 0; i < memory->len_insts; ++i) {
-        printf("%3hu", i);
-        show_inst(memory->insts[i]);
-    }
-    printf("\n");
-}
-
-STATIC_ASSERT(CAP_STRING == 64, "CAP_STRING != 64");
-static void push_threads(Threads* threads, u16 index, u16 start) {
-    if ((threads->flags[index] >> start) & 1lu) {
-        return;
-    }
-    EXIT_IF(CAP_THREADS <= threads->len);
-    threads->buffer[threads->len++] = (Thread){
-        .index = index,
-        .start = start,
-    };
-    threads->flags[index] |= 1lu << start;
-}
-
-static Bounds search(Memory* memory, String string) {
-    EXIT_IF(CAP_STRING <= string.len);
-    memset(&memory->flags[0][0], 0, 2 * CAP_FLAGS);
-    Threads current = {
-        .buffer = &memory->threads[0][0],
-        .flags = &memory->flags[0][0],
-        .len = 0,
-    };
-    Threads next = {
-        .buffer = &memory->threads[1][0],
-        .flags = &memory->flags[1][0],
-        .len = 0,
-    };
-    Bounds result = {0};
-    for (u16 i = 0; i < string.len; ++i) {
-        push_threads(&current, 0, i);
-        for (u16 j = 0; j < current.len; ++j) {
-            Inst inst = memory->insts[current.buffer[j].index];
-            u16  start = current.buffer[j].start;
+        if (memory->insts[i].tag == INST_MATCH) {
+            memory->match_insts |= 1lu << i;
+        }
+        u16 stack[2 * CAP_INSTS];
+        u16 len_stack = 0;
+        u64 visited = 0;
+        u64 closure = 0;
+        stack[len_stack++] = i;
+        while (len_stack != 0) {
+            u16 index = stack[--len_stack];
+            if ((visited >> index) & 1lu) {
+                continue;
+            }
+            visited |= 1lu << index;
+            Inst inst = memory->insts[index];
             switch (inst.tag) {
+            case INST_MATCH:
             case INST_CHAR: {
-                if (string.chars[i] == inst.op.as_char) {
-                    push_threads(&next, current.buffer[j].index + 1, start);
-                }
+                closure |= 1lu << index;
                 break;
             }
             case INST_JUMP: {
-                push_threads(&current, inst.op.as_line[0], start);
+                stack[len_stack++] = inst.op.as_line[0];
                 break;
             }
-            case INST_SPLIT: {
-                push_threads(&current, inst.op.as_line[0], start);
-                push_threads(&current, inst.op.as_line[1], start);
+            case INST_SAVE: {
+                stack[len_stack++] = (u16)(index + 1);
                 break;
             }
-            case INST_MATCH: {
-                if ((!result.match) || (result.start == result.end)) {
-                    result = (Bounds){
-                        .start = start,
-                        .end = i,
-                        .match = TRUE,
-                    };
-                } else if ((result.start == start) && (result.end < i)) {
-                    result.end = i;
+            case INST_REPEAT: {
+                closure |= 1lu << index;
+                if (memory->counters[inst.op.as_counter].range.min == 0) {
+                    stack[len_stack++] = (u16)(index + 1);
                 }
                 break;
             }
+            case INST_SPLIT: {
+                stack[len_stack++] = inst.op.as_line[1];
+                stack[len_stack++] = inst.op.as_line[0];
+                break;
+            }
             default: {
                 ERROR();
             }
             }
         }
-        {
-            Thread* buffer = current.buffer;
-            u64*    flags = current.flags;
-            current = next;
-            next = (Threads){
-                .buffer = buffer,
-                .flags = flags,
-                .len = 0,
-            };
-            memset(&next.flags[0], 0, CAP_FLAGS);
-        }
-    }
-    for (u16 i = 0; i < current.len; ++i) {
-        Inst inst = memory->insts[current.buffer[i].index];
-        u16  start = current.buffer[i].start;
-        switch (inst.tag) {
-        case INST_CHAR: {
-            break;
-        }
-        case INST_JUMP: {
-            push_threads(&current, inst.op.as_line[0], start);
-            break;
-        }
-        case INST_SPLIT: {
-            push_threads(&current, inst.op.as_line[0], start);
-            push_threads(&current, inst.op.as_line[1], start);
-            break;
-        }
-        case INST_MATCH: {
-            if ((!result.match) || (result.start == result.end)) {
-                result = (Bounds){
-                    .start = start,
-                    .end = string.len,
-                    .match = TRUE,
-                };
-            } else if ((result.start == start) && (result.end < string.len)) {
-                result.end = string.len;
-            }
-            break;
-        }
-        default: {
-            ERROR();
-        }
-        }
+        memory->closures[i] = closure;
     }
-    return result;
 }
 
-#define SEARCH(memory, string_literal, start_, end_)               \
-    {                                                              \
-        Bounds result = search(memory, TO_STRING(string_literal)); \
-        EXIT_IF((!result.match) || (result.start != start_) ||     \
-                (result.end != end_));                             \
-        fprintf(stderr, ".");                                      \
+static u64 get_matches(Memory* memory, u64 insts) {
+    u64 matches = 0;
+    insts &= memory->match_insts;
+    while (insts != 0) {
+        matches |= 1lu << memory->insts[__builtin_ctzl(insts)].op.as_id;
+        insts &= insts - 1;
     }
+    return matches;
+}
 
-#define NO_SEARCH(memory, string_literal)                         \
-    {                                                             \
-        EXIT_IF(search(memory, TO_STRING(string_literal)).match); \
-        fprintf(stderr, ".");                                     \
+// NOTE: State `0` is always the start state, `closures[0]`; a budget of `0`
+// means `CAP_DFA`.
+static u16 get_dfa_state(Memory* memory, u64 insts) {
+    for (u16 i = 0; i < memory->len_dfa_states; ++i) {
+        if (memory->dfa_states[i].insts == insts) {
+            return i;
+        }
+    }
+    EXIT_IF(CAP_DFA < memory->budget_dfa_states);
+    u16 budget = memory->budget_dfa_states != 0 ? memory->budget_dfa_states
+                                                : CAP_DFA;
+    if (budget <= memory->len_dfa_states) {
+        return DFA_UNKNOWN;
     }
+    u16 index = memory->len_dfa_states++;
+    memory->dfa_states[index] = (DfaState){
+        .insts = insts,
+        .matches = get_matches(memory, insts),
+    };
+    for (u16 i = 0; i < CAP_BYTES; ++i) {
+        memory->dfa_transitions[index][i] = DFA_UNKNOWN;
+    }
+    return index;
+}
 
-i32 main(void) {
-    printf("\n"
+static void set_factors(Expr* expr, Expr** factors, u16* len_factors) {
+    if (!expr) {
+        return;
+    }
+    if (expr->tag == EXPR_CONCAT) {
+        set_factors(expr->op.as_expr[0], factors, len_factors);
+        set_factors(expr->op.as_expr[1], factors, len_factors);
+        return;
+    }
+    if (expr->tag == EXPR_GROUP) {
+        set_factors(expr->op.as_group.expr, factors, len_factors);
+        return;
+    }
+    EXIT_IF(CAP_EXPRS <= *len_factors);
+    factors[(*len_factors)++] = expr;
+}
+
+static void set_literal(Memory* memory, Expr* expr) {
+    Expr* factors[CAP_EXPRS];
+    u16   len_factors = 0;
+    set_factors(expr, factors, &len_factors);
+    u16 best_start = 0;
+    u16 best_len = 0;
+    for (u16 i = 0; i < len_factors;) {
+        if (factors[i]->tag != EXPR_CHAR) {
+            ++i;
+            continue;
+        }
+        u16 start = i;
+        while ((i < len_factors) && (factors[i]->tag == EXPR_CHAR)) {
+            ++i;
+        }
+        if ((best_len < (i - start)) && ((best_len == 0) || (best_start != 0)))
+        {
+            best_start = start;
+            best_len = (u16)(i - start);
+        }
+    }
+    memory->len_literal = best_len < CAP_LITERAL ? best_len : CAP_LITERAL;
+    memory->literal_prefix = (best_len != 0) && (best_start == 0);
+    for (u16 i = 0; i < memory->len_literal; ++i) {
+        memory->literal[i] = factors[best_start + i]->op.as_char;
+    }
+}
+
+#define FOR_EACH_BIT(mask, index, block)            \
+    {                                               \
+        u64 bits_ = mask;                           \
+        while (bits_ != 0) {                        \
+            u16 index = (u16)__builtin_ctzl(bits_); \
+            block;                                  \
+            bits_ &= bits_ - 1;                     \
+        }                                           \
+    }
+
+static Glushkov set_glushkov(Memory* memory, Expr* expr) {
+    if (!expr) {
+        return (Glushkov){
+            .first = 0,
+            .last = 0,
+            .nullable = TRUE,
+        };
+    }
+    switch (expr->tag) {
+    case EXPR_CHAR: {
+        EXIT_IF(CAP_POSITIONS <= memory->len_positions);
+        u64 position = 1lu << memory->len_positions++;
+        memory->positions[(u8)expr->op.as_char] |= position;
+        return (Glushkov){
+            .first = position,
+            .last = position,
+            .nullable = FALSE,
+        };
+    }
+    case EXPR_CONCAT: {
+        Glushkov a = set_glushkov(memory, expr->op.as_expr[0]);
+        Glushkov b = set_glushkov(memory, expr->op.as_expr[1]);
+        FOR_EACH_BIT(a.last, i, memory->follows[i] |= b.first);
+        return (Glushkov){
+            .first = a.nullable ? a.first | b.first : a.first,
+            .last = b.nullable ? a.last | b.last : b.last,
+            .nullable = a.nullable && b.nullable,
+        };
+    }
+    case EXPR_OR: {
+        Glushkov a = set_glushkov(memory, expr->op.as_expr[0]);
+        Glushkov b = set_glushkov(memory, expr->op.as_expr[1]);
+        return (Glushkov){
+            .first = a.first | b.first,
+            .last = a.last | b.last,
+            .nullable = a.nullable || b.nullable,
+        };
+    }
+    case EXPR_ZERO_OR_ONE: {
+        Glushkov a = set_glushkov(memory, expr->op.as_expr[0]);
+        a.nullable = TRUE;
+        return a;
+    }
+    case EXPR_ZERO_OR_MANY:
+    case EXPR_ONE_OR_MANY: {
+        Glushkov a = set_glushkov(memory, expr->op.as_expr[0]);
+        FOR_EACH_BIT(a.last, i, memory->follows[i] |= a.first);
+        if (expr->tag == EXPR_ZERO_OR_MANY) {
+            a.nullable = TRUE;
+        }
+        return a;
+    }
+    case EXPR_GROUP: {
+        return set_glushkov(memory, expr->op.as_group.expr);
+    }
+    case EXPR_REPEAT:
+    default: {
+        ERROR();
+    }
+    }
+}
+
+static void set_follow_tables(Memory* memory) {
+    for (u16 i = 0; (8 * i) < memory->len_positions; ++i) {
+        for (u16 j = 0; j < CAP_BYTES; ++j) {
+            u64 follow = 0;
+            FOR_EACH_BIT(j, k, follow |= memory->follows[(8 * i) + k]);
+            memory->follow_tables[i][j] = follow;
+        }
+    }
+}
+
+static u16 count_chars(Expr* expr) {
+    if (!expr) {
+        return 0;
+    }
+    switch (expr->tag) {
+    case EXPR_CHAR: {
+        return 1;
+    }
+    case EXPR_CONCAT:
+    case EXPR_OR: {
+        return (u16)(count_chars(expr->op.as_expr[0]) +
+                     count_chars(expr->op.as_expr[1]));
+    }
+    case EXPR_ZERO_OR_ONE:
+    case EXPR_ZERO_OR_MANY:
+    case EXPR_ONE_OR_MANY: {
+        return count_chars(expr->op.as_expr[0]);
+    }
+    case EXPR_GROUP: {
+        return count_chars(expr->op.as_group.expr);
+    }
+    case EXPR_REPEAT: {
+        return CAP_POSITIONS + 1;
+    }
+    default: {
+        ERROR();
+    }
+    }
+}
+
+static void set_engine(Memory* memory, Expr* expr) {
+    memory->engine = ENGINE_DFA;
+    if (CAP_POSITIONS < count_chars(expr)) {
+        return;
+    }
+    memset(&memory->positions[0], 0, sizeof(memory->positions));
+    memset(&memory->follows[0], 0, sizeof(memory->follows));
+    memory->len_positions = 0;
+    memory->glushkov = set_glushkov(memory, expr);
+    set_follow_tables(memory);
+    memory->engine = ENGINE_GLUSHKOV;
+}
+
+static void emit_set(Memory* memory, Expr** exprs, u16 len) {
+    for (u16 i = 0; i < len; ++i) {
+        u16 label = 0;
+        if ((i + 1) < len) {
+            u16 label_0 = memory->len_labels++;
+            label = memory->len_labels++;
+            EMIT_SPLIT(label_0, label);
+            EMIT_PRE_INST_LABEL(PRE_INST_LABEL, label_0);
+        }
+        emit(memory, exprs[i]);
+        {
+            PreInst* pre_inst = alloc_pre_inst(memory);
+            pre_inst->tag = PRE_INST_MATCH;
+            pre_inst->op.as_id = i;
+        }
+        if ((i + 1) < len) {
+            EMIT_PRE_INST_LABEL(PRE_INST_LABEL, label);
+        }
+    }
+}
+
+static void set_reverse(Memory* memory, Expr** exprs, u16 len) {
+    memory->reverse = TRUE;
+    emit_set(memory, exprs, len);
+    memory->reverse = FALSE;
+    resolve_labels(memory);
+    set_closures(memory);
+    memcpy(memory->reverse_insts,
+           memory->insts,
+           sizeof(Inst) * memory->len_insts);
+    memcpy(memory->reverse_closures,
+           memory->closures,
+           sizeof(u64) * memory->len_insts);
+    memory->reverse_match_insts = memory->match_insts;
+    memory->len_reverse_insts = memory->len_insts;
+    memory->len_pre_insts = 0;
+    memory->len_labels = 0;
+    memory->len_insts = 0;
+}
+
+static Expr* compile(Memory* memory, String regex) {
+    reset(memory);
+    set_tokens(memory, regex);
+    Expr* expr = parse_expr(memory, BINDING_INIT);
+    set_reverse(memory, &expr, 1);
+    emit_set(memory, &expr, 1);
+    resolve_labels(memory);
+    set_closures(memory);
+    set_literal(memory, expr);
+    set_engine(memory, expr);
+    memory->len_dfa_states = 0;
+    memory->len_jit = 0;
+    return expr;
+}
+
+static void compile_set(Memory* memory, const String* regexes, u16 len) {
+    EXIT_IF((len == 0) || (CAP_PATTERNS < len));
+    reset(memory);
+    memory->expand_repeats = TRUE;
+    Expr* exprs[CAP_PATTERNS];
+    for (u16 i = 0; i < len; ++i) {
+        set_tokens(memory, regexes[i]);
+        exprs[i] = parse_expr(memory, BINDING_INIT);
+        EXIT_IF(!TOKENS_EMPTY(memory));
+    }
+    set_reverse(memory, exprs, len);
+    emit_set(memory, exprs, len);
+    resolve_labels(memory);
+    set_closures(memory);
+    memory->len_literal = 0;
+    memory->literal_prefix = FALSE;
+    memory->engine = ENGINE_DFA;
+    memory->len_dfa_states = 0;
+    memory->len_jit = 0;
+}
+
+NO_INT_SAN static u64 get_hash(String string) {
+    u64 hash = FNV_OFFSET;
+    for (u16 i = 0; i < string.len; ++i) {
+        hash = (hash ^ (u8)string.chars[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+#define FIELD(field)                            \
+    {                                           \
+        .offset = offsetof(Memory, field),      \
+        .size = sizeof(((Memory*)NULL)->field), \
+    }
+
+#define FIELD_PREFIX(field, len_field, unit_len)     \
+    {                                                \
+        .offset = offsetof(Memory, field),           \
+        .size = sizeof(((Memory*)NULL)->field),      \
+        .stride = sizeof(((Memory*)NULL)->field[0]), \
+        .len = offsetof(Memory, len_field),          \
+        .unit = unit_len,                            \
+    }
+
+static const Field PROGRAM_FIELDS[] = {
+    FIELD(len_groups),
+    FIELD_PREFIX(insts, len_insts, 1),
+    FIELD_PREFIX(counters, len_counters, 1),
+    FIELD_PREFIX(reverse_insts, len_reverse_insts, 1),
+    FIELD_PREFIX(reverse_closures, len_reverse_insts, 1),
+    FIELD(reverse_match_insts),
+    FIELD_PREFIX(closures, len_insts, 1),
+    FIELD(match_insts),
+    FIELD_PREFIX(literal, len_literal, 1),
+    FIELD(literal_prefix),
+    FIELD(glushkov),
+    FIELD(positions),
+    FIELD_PREFIX(follows, len_positions, 1),
+    FIELD_PREFIX(follow_tables, len_positions, 8),
+    FIELD(engine),
+};
+
+static u64 get_field_len(const Memory* memory, Field field) {
+    if (!field.stride) {
+        return field.size;
+    }
+    u16 len;
+    memcpy(&len, &((const u8*)memory)[field.len], sizeof(u16));
+    return ((len + field.unit - 1lu) / field.unit) * field.stride;
+}
+
+static u64 get_program_len(const Memory* memory) {
+    u64 len = sizeof(ProgramHeader);
+    for (u32 i = 0; i < LEN_ARRAY(PROGRAM_FIELDS); ++i) {
+        len += get_field_len(memory, PROGRAM_FIELDS[i]);
+    }
+    EXIT_IF(CAP_PROGRAM < len);
+    return len;
+}
+
+static u64 get_program_layout(void) {
+    u64 sizes[LEN_ARRAY(PROGRAM_FIELDS) + 10];
+    u32 len = 0;
+    for (u32 i = 0; i < LEN_ARRAY(PROGRAM_FIELDS); ++i) {
+        sizes[len++] = PROGRAM_FIELDS[i].size;
+    }
+    sizes[len++] = sizeof(Bool);
+    sizes[len++] = sizeof(InstTag);
+    sizes[len++] = sizeof(Engine);
+    sizes[len++] = sizeof(InstOp);
+    sizes[len++] = sizeof(Inst);
+    sizes[len++] = offsetof(Inst, tag);
+    sizes[len++] = sizeof(Counter);
+    sizes[len++] = offsetof(Counter, range);
+    sizes[len++] = sizeof(Glushkov);
+    sizes[len++] = offsetof(Glushkov, nullable);
+    return get_hash((String){
+        .chars = (const char*)sizes,
+        .len = (u16)(sizeof(u64) * len),
+    });
+}
+
+static Bool is_mask_valid(u64 mask, u16 len) {
+    return (64 <= len) || ((mask >> len) == 0);
+}
+
+static Bool is_insts_valid(const Inst* insts,
+                           const u64*  closures,
+                           u16         len,
+                           u16         len_counters) {
+    for (u16 i = 0; i < len; ++i) {
+        Inst inst = insts[i];
+        if (!is_mask_valid(closures[i], len)) {
+            return FALSE;
+        }
+        switch (inst.tag) {
+        case INST_MATCH: {
+            if (CAP_PATTERNS <= inst.op.as_id) {
+                return FALSE;
+            }
+            break;
+        }
+        case INST_CHAR: {
+            if (len <= (i + 1)) {
+                return FALSE;
+            }
+            break;
+        }
+        case INST_JUMP: {
+            if (len <= inst.op.as_line[0]) {
+                return FALSE;
+            }
+            break;
+        }
+        case INST_SPLIT: {
+            if ((len <= inst.op.as_line[0]) || (len <= inst.op.as_line[1])) {
+                return FALSE;
+            }
+            break;
+        }
+        case INST_SAVE: {
+            if ((len <= (i + 1)) || (CAP_SLOTS <= inst.op.as_slot)) {
+                return FALSE;
+            }
+            break;
+        }
+        case INST_REPEAT: {
+            if ((len <= (i + 1)) || (len_counters <= inst.op.as_counter)) {
+                return FALSE;
+            }
+            break;
+        }
+        default: {
+            return FALSE;
+        }
+        }
+    }
+    return TRUE;
+}
+
+static Bool is_program_valid(const Memory* memory) {
+    if ((CAP_EXPRS < memory->len_groups) ||
+        (CAP_INSTS < memory->len_insts) || (memory->len_insts == 0) ||
+        (CAP_INSTS < memory->len_reverse_insts) ||
+        (CAP_COUNTERS < memory->len_counters) ||
+        (CAP_LITERAL < memory->len_literal) ||
+        (CAP_POSITIONS < memory->len_positions) ||
+        (TRUE < memory->literal_prefix) ||
+        (TRUE < memory->glushkov.nullable) ||
+        (ENGINE_GLUSHKOV < memory->engine))
+    {
+        return FALSE;
+    }
+    for (u16 i = 0; i < memory->len_counters; ++i) {
+        Range range = memory->counters[i].range;
+        if ((63 < get_counter_top(range)) ||
+            ((range.max != RANGE_INF) && (range.max < range.min)))
+        {
+            return FALSE;
+        }
+    }
+    if ((!is_insts_valid(memory->insts,
+                         memory->closures,
+                         memory->len_insts,
+                         memory->len_counters)) ||
+        (!is_mask_valid(memory->match_insts, memory->len_insts)) ||
+        (!is_insts_valid(memory->reverse_insts,
+                         memory->reverse_closures,
+                         memory->len_reverse_insts,
+                         memory->len_counters)) ||
+        (!is_mask_valid(memory->reverse_match_insts,
+                        memory->len_reverse_insts)))
+    {
+        return FALSE;
+    }
+    u16 len = memory->len_positions;
+    if ((!is_mask_valid(memory->glushkov.first, len)) ||
+        (!is_mask_valid(memory->glushkov.last, len)))
+    {
+        return FALSE;
+    }
+    for (u16 i = 0; i < CAP_BYTES; ++i) {
+        if (!is_mask_valid(memory->positions[i], len)) {
+            return FALSE;
+        }
+        for (u16 j = 0; j < ((len + 7) / 8); ++j) {
+            if (!is_mask_valid(memory->follow_tables[j][i], len)) {
+                return FALSE;
+            }
+        }
+    }
+    for (u16 i = 0; i < len; ++i) {
+        if (!is_mask_valid(memory->follows[i], len)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static u64 save_program(Memory* memory, u8* bytes) {
+    ProgramHeader header = {
+        .magic = PROGRAM_MAGIC,
+        .version = PROGRAM_VERSION,
+        .len = get_program_len(memory),
+        .layout = get_program_layout(),
+        .len_insts = memory->len_insts,
+        .len_reverse_insts = memory->len_reverse_insts,
+        .len_counters = memory->len_counters,
+        .len_literal = memory->len_literal,
+        .len_positions = memory->len_positions,
+    };
+    memcpy(bytes, &header, sizeof(ProgramHeader));
+    u64 offset = sizeof(ProgramHeader);
+    for (u32 i = 0; i < LEN_ARRAY(PROGRAM_FIELDS); ++i) {
+        u64 len = get_field_len(memory, PROGRAM_FIELDS[i]);
+        memcpy(&bytes[offset],
+               &((const u8*)memory)[PROGRAM_FIELDS[i].offset],
+               len);
+        offset += len;
+    }
+    return offset;
+}
+
+static void load_program(Memory* memory, const u8* bytes, u64 len) {
+    ProgramHeader header;
+    EXIT_IF(len < sizeof(ProgramHeader));
+    memcpy(&header, bytes, sizeof(ProgramHeader));
+    EXIT_IF((header.magic != PROGRAM_MAGIC) ||
+            (header.version != PROGRAM_VERSION) || (header.len != len) ||
+            (header.layout != get_program_layout()));
+    EXIT_IF((CAP_INSTS < header.len_insts) ||
+            (CAP_INSTS < header.len_reverse_insts) ||
+            (CAP_COUNTERS < header.len_counters) ||
+            (CAP_LITERAL < header.len_literal) ||
+            (CAP_POSITIONS < header.len_positions));
+    memory->len_insts = header.len_insts;
+    memory->len_reverse_insts = header.len_reverse_insts;
+    memory->len_counters = header.len_counters;
+    memory->len_literal = header.len_literal;
+    memory->len_positions = header.len_positions;
+    EXIT_IF(get_program_len(memory) != len);
+    u64 offset = sizeof(ProgramHeader);
+    for (u32 i = 0; i < LEN_ARRAY(PROGRAM_FIELDS); ++i) {
+        u64 len_field = get_field_len(memory, PROGRAM_FIELDS[i]);
+        memcpy(&((u8*)memory)[PROGRAM_FIELDS[i].offset],
+               &bytes[offset],
+               len_field);
+        offset += len_field;
+    }
+    EXIT_IF(!is_program_valid(memory));
+    memory->len_dfa_states = 0;
+    memory->len_jit = 0;
+}
+
+static void write_program(Memory* memory, FILE* file) {
+    u8  bytes[CAP_PROGRAM];
+    u64 len = save_program(memory, bytes);
+    EXIT_IF(fwrite(bytes, 1, len, file) != len);
+    EXIT_IF(fflush(file));
+}
+
+static void read_program(Memory* memory, i32 descriptor) {
+    Stat info;
+    EXIT_IF(fstat(descriptor, &info));
+    u64   len = (u64)info.st_size;
+    void* address = mmap(NULL, len, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    EXIT_IF(address == MAP_FAILED);
+    load_program(memory, address, len);
+    EXIT_IF(munmap(address, len));
+}
+
+static void compile_cached(Memory* memory, Cache* cache, String regex) {
+    u64 hash = get_hash(regex);
+    for (u16 i = 0; i < cache->len; ++i) {
+        if ((cache->hashes[i] == hash) && (cache->len_keys[i] == regex.len) &&
+            (!memcmp(cache->keys[i], regex.chars, regex.len)))
+        {
+            load_program(memory,
+                         cache->programs[i],
+                         cache->len_programs[i]);
+            ++cache->hits;
+            return;
+        }
+    }
+    compile(memory, regex);
+    ++cache->misses;
+    if (CAP_CACHE_KEY < regex.len) {
+        return;
+    }
+    u16 index = cache->next;
+    cache->next = (u16)((cache->next + 1) % CAP_CACHE);
+    if (cache->len < CAP_CACHE) {
+        ++cache->len;
+    }
+    cache->len_programs[index] = save_program(memory, cache->programs[index]);
+    memcpy(cache->keys[index], regex.chars, regex.len);
+    cache->hashes[index] = hash;
+    cache->len_keys[index] = regex.len;
+}
+
+#define LINE_FMT "%hu"
+
+static void show_inst(Inst inst) {
+    switch (inst.tag) {
+    case INST_MATCH: {
+        printf("\tmatch\t%hu\n", inst.op.as_id);
+        break;
+    }
+    case INST_CHAR: {
+        printf("\tchar\t'%c'\n", inst.op.as_char);
+        break;
+    }
+    case INST_JUMP: {
+        printf("\tjump\t" LINE_FMT "\n", inst.op.as_line[0]);
+        break;
+    }
+    case INST_SPLIT:
+        printf("\tsplit\t" LINE_FMT ",\t" LINE_FMT "\n",
+               inst.op.as_line[0],
+               inst.op.as_line[1]);
+        break;
+    case INST_SAVE: {
+        printf("\tsave\t%hu\n", inst.op.as_slot);
+        break;
+    }
+    case INST_REPEAT: {
+        printf("\trepeat\t%hu\n", inst.op.as_counter);
+        break;
+    }
+    default: {
+        ERROR();
+    }
+    }
+}
+
+static void show_all(Memory* memory, Expr* expr) {
+    for (u16 i = 0; i < memory->len_tokens; ++i) {
+        show_token(memory->tokens[i]);
+    }
+    printf("\n");
+    show_expr(expr, 0);
+    printf("\n");
+    for (u16 i = 0; i < memory->len_insts; ++i) {
+        printf("%3hu", i);
+        show_inst(memory->insts[i]);
+    }
+    printf("\n");
+    if (memory->len_literal != 0) {
+        printf("%s\t\"%.*s\"\n\n",
+               memory->literal_prefix ? "prefix" : "literal",
+               memory->len_literal,
+               memory->literal);
+    }
+}
+
+static u16 find_literal(Memory* memory, String string, u16 start) {
+    u16 len = memory->len_literal;
+    if ((len == 0) || (string.len < len)) {
+        return len == 0 ? start : string.len;
+    }
+    u16       last = (u16)(string.len - len);
+    u16       i = start;
+    SimdBytes first_char = SIMD_SET(memory->literal[0]);
+    SimdBytes last_char = SIMD_SET(memory->literal[len - 1]);
+    for (; (i + SIMD_WIDTH) <= (last + 1); i = (u16)(i + SIMD_WIDTH)) {
+        SimdBytes first_chars = SIMD_LOAD(&string.chars[i]);
+        SimdBytes last_chars = SIMD_LOAD(&string.chars[i + len - 1]);
+        u32       mask = SIMD_MASK(SIMD_AND(SIMD_EQ(first_char, first_chars),
+                                            SIMD_EQ(last_char, last_chars)));
+        while (mask != 0) {
+            u16 j = (u16)(i + __builtin_ctz(mask));
+            if (!memcmp(&string.chars[j], memory->literal, len)) {
+                return j;
+            }
+            mask &= mask - 1;
+        }
+    }
+    for (; i <= last; ++i) {
+        if (!memcmp(&string.chars[i], memory->literal, len)) {
+            return i;
+        }
+    }
+    return string.len;
+}
+
+// NOTE: Bit `k` of the counts on a `repeat` line stands for `k` bytes read.
+static u64 step_counts(Counter* counter, u64 counts, u8 byte) {
+    if (!((counter->bytes[byte / 64] >> (byte % 64)) & 1lu)) {
+        return 0;
+    }
+    u16 top = get_counter_top(counter->range);
+    u64 next = counts << 1;
+    if (counter->range.max == RANGE_INF) {
+        next |= counts & (1lu << top);
+    }
+    return top == 63 ? next : next & ((1lu << (top + 1)) - 1);
+}
+
+static Bool is_counted(Counter* counter, u64 counts) {
+    return (counts >> counter->range.min) != 0;
+}
+
+STATIC_ASSERT(CAP_STRING == 64, "CAP_STRING != 64");
+static void push_threads(Threads* threads, u16 index, u64 start, u64 counts) {
+    u64* seen = &threads->counts[(index * CAP_STRING) + start];
+    if ((threads->flags[index] >> start) & 1lu) {
+        counts &= ~*seen;
+        if (counts == 0) {
+            return;
+        }
+        *seen |= counts;
+    } else {
+        threads->flags[index] |= 1lu << start;
+        *seen = counts;
+    }
+    EXIT_IF(CAP_THREADS <= threads->len);
+    threads->buffer[threads->len++] = (Thread){
+        .index = index,
+        .start = start,
+        .counts = counts,
+    };
+}
+
+static Bounds search(Memory* memory, String string) {
+    EXIT_IF(CAP_STRING <= string.len);
+    u16 first = find_literal(memory, string, 0);
+    if (string.len <= first) {
+        return (Bounds){0};
+    }
+    memset(&memory->flags[0][0], 0, 2 * CAP_FLAGS);
+    Threads current = {
+        .buffer = &memory->threads[0][0],
+        .flags = &memory->flags[0][0],
+        .counts = &memory->counts[0][0],
+        .len = 0,
+    };
+    Threads next = {
+        .buffer = &memory->threads[1][0],
+        .flags = &memory->flags[1][0],
+        .counts = &memory->counts[1][0],
+        .len = 0,
+    };
+    Bounds result = {0};
+    for (u16 i = memory->literal_prefix ? first : 0; i < string.len; ++i) {
+        if (result.match && (current.len == 0)) {
+            break;
+        }
+        if (memory->literal_prefix && (current.len == 0)) {
+            i = find_literal(memory, string, i);
+            if (string.len <= i) {
+                break;
+            }
+        }
+        if (!result.match) {
+            push_threads(&current, 0, i, COUNTS_ZERO);
+        }
+        for (u16 j = 0; j < current.len; ++j) {
+            Inst inst = memory->insts[current.buffer[j].index];
+            u64  start = current.buffer[j].start;
+            switch (inst.tag) {
+            case INST_CHAR: {
+                if (string.chars[i] == inst.op.as_char) {
+                    push_threads(&next,
+                                 current.buffer[j].index + 1,
+                                 start,
+                                 COUNTS_ZERO);
+                }
+                break;
+            }
+            case INST_JUMP: {
+                push_threads(&current, inst.op.as_line[0], start, COUNTS_ZERO);
+                break;
+            }
+            case INST_SPLIT: {
+                push_threads(&current, inst.op.as_line[0], start, COUNTS_ZERO);
+                push_threads(&current, inst.op.as_line[1], start, COUNTS_ZERO);
+                break;
+            }
+            case INST_SAVE: {
+                push_threads(&current,
+                             current.buffer[j].index + 1,
+                             start,
+                             COUNTS_ZERO);
+                break;
+            }
+            case INST_REPEAT: {
+                Counter* counter = &memory->counters[inst.op.as_counter];
+                u64      counts = current.buffer[j].counts;
+                if (is_counted(counter, counts)) {
+                    push_threads(&current,
+                                 current.buffer[j].index + 1,
+                                 start,
+                                 COUNTS_ZERO);
+                }
+                counts = step_counts(counter, counts, (u8)string.chars[i]);
+                if (counts != 0) {
+                    push_threads(&next,
+                                 current.buffer[j].index,
+                                 start,
+                                 counts);
+                }
+                break;
+            }
+            case INST_MATCH: {
+                if ((!result.match) || (start < result.start)) {
+                    result = (Bounds){
+                        .start = start,
+                        .end = i,
+                        .match = TRUE,
+                    };
+                } else if ((result.start == start) && (result.end < i)) {
+                    result.end = i;
+                }
+                break;
+            }
+            default: {
+                ERROR();
+            }
+            }
+        }
+        {
+            Thread* buffer = current.buffer;
+            u64*    flags = current.flags;
+            u64*    counts = current.counts;
+            current = next;
+            next = (Threads){
+                .buffer = buffer,
+                .flags = flags,
+                .counts = counts,
+                .len = 0,
+            };
+            memset(&next.flags[0], 0, CAP_FLAGS);
+        }
+    }
+    for (u16 i = 0; i < current.len; ++i) {
+        Inst inst = memory->insts[current.buffer[i].index];
+        u64  start = current.buffer[i].start;
+        switch (inst.tag) {
+        case INST_CHAR: {
+            break;
+        }
+        case INST_JUMP: {
+            push_threads(&current, inst.op.as_line[0], start, COUNTS_ZERO);
+            break;
+        }
+        case INST_SPLIT: {
+            push_threads(&current, inst.op.as_line[0], start, COUNTS_ZERO);
+            push_threads(&current, inst.op.as_line[1], start, COUNTS_ZERO);
+            break;
+        }
+        case INST_SAVE: {
+            push_threads(&current,
+                         current.buffer[i].index + 1,
+                         start,
+                         COUNTS_ZERO);
+            break;
+        }
+        case INST_REPEAT: {
+            if (is_counted(&memory->counters[inst.op.as_counter],
+                           current.buffer[i].counts))
+            {
+                push_threads(&current,
+                             current.buffer[i].index + 1,
+                             start,
+                             COUNTS_ZERO);
+            }
+            break;
+        }
+        case INST_MATCH: {
+            if ((!result.match) || (start < result.start)) {
+                result = (Bounds){
+                    .start = start,
+                    .end = string.len,
+                    .match = TRUE,
+                };
+            } else if ((result.start == start) && (result.end < string.len)) {
+                result.end = string.len;
+            }
+            break;
+        }
+        default: {
+            ERROR();
+        }
+        }
+    }
+    return result;
+}
+
+static u64 step_anchored(const Inst* program,
+                         const u64*  closures,
+                         u64         insts,
+                         u8          byte) {
+    u64 next = 0;
+    while (insts != 0) {
+        u16  index = (u16)__builtin_ctzl(insts);
+        Inst inst = program[index];
+        if ((inst.tag == INST_CHAR) && ((u8)inst.op.as_char == byte)) {
+            next |= closures[index + 1];
+        }
+        insts &= insts - 1;
+    }
+    return next;
+}
+
+static u64 step_insts(Memory* memory, u64 insts, u8 byte) {
+    return memory->closures[0] |
+           step_anchored(memory->insts, memory->closures, insts, byte);
+}
+
+static u16 step_dfa(Memory* memory, u16 state, u8 byte) {
+    u64 next = step_insts(memory, memory->dfa_states[state].insts, byte);
+    u16 index = get_dfa_state(memory, next);
+    if (index == DFA_UNKNOWN) {
+        memory->len_dfa_states = 0;
+        EXIT_IF(get_dfa_state(memory, memory->closures[0]) != 0);
+        index = get_dfa_state(memory, next);
+        if ((index == DFA_UNKNOWN) || (state != 0)) {
+            return index;
+        }
+    }
+    memory->dfa_transitions[state][byte] = index;
+    return index;
+}
+
+static Bounds get_bounds(Memory*, String);
+
+static Bounds search_dfa(Memory* memory, String string) {
+    if (string.len == 0) {
+        return (Bounds){0};
+    }
+    if (memory->len_counters != 0) {
+        return get_bounds(memory, string);
+    }
+    u16 first = find_literal(memory, string, 0);
+    if (string.len <= first) {
+        return (Bounds){0};
+    }
+    u16 start = get_dfa_state(memory, memory->closures[0]);
+    if ((start == DFA_UNKNOWN) || (memory->dfa_states[start].matches != 0)) {
+        return get_bounds(memory, string);
+    }
+    u16 state = start;
+    for (u16 i = memory->literal_prefix ? first : 0; i < string.len; ++i) {
+        if (memory->literal_prefix && (state == start)) {
+            i = find_literal(memory, string, i);
+            if (string.len <= i) {
+                break;
+            }
+        }
+        u8  byte = (u8)string.chars[i];
+        u16 next = memory->dfa_transitions[state][byte];
+        if (next == DFA_UNKNOWN) {
+            next = step_dfa(memory, state, byte);
+            if (next == DFA_UNKNOWN) {
+                return get_bounds(memory, string);
+            }
+        }
+        if (memory->dfa_states[next].matches != 0) {
+            return get_bounds(memory, string);
+        }
+        state = next;
+    }
+    return (Bounds){0};
+}
+
+static u64 search_set(Memory* memory, String string) {
+    EXIT_IF(memory->len_counters != 0);
+    if (string.len == 0) {
+        return 0;
+    }
+    u64 all = get_matches(memory, memory->match_insts);
+    u64 insts = memory->closures[0];
+    u16 state = get_dfa_state(memory, insts);
+    u64 matches = 0;
+    for (u16 i = 0; i <= string.len; ++i) {
+        matches |= state != DFA_UNKNOWN ? memory->dfa_states[state].matches
+                                        : get_matches(memory, insts);
+        if ((matches == all) || (i == string.len)) {
+            break;
+        }
+        u8 byte = (u8)string.chars[i];
+        if (state != DFA_UNKNOWN) {
+            insts = memory->dfa_states[state].insts;
+            u16 next = memory->dfa_transitions[state][byte];
+            if (next == DFA_UNKNOWN) {
+                next = step_dfa(memory, state, byte);
+            }
+            if (next != DFA_UNKNOWN) {
+                state = next;
+                continue;
+            }
+        }
+        insts = step_insts(memory, insts, byte);
+        state = DFA_UNKNOWN;
+    }
+    return matches;
+}
+
+static Bounds search_glushkov(Memory* memory, String string) {
+    if (string.len <= find_literal(memory, string, 0)) {
+        return (Bounds){0};
+    }
+    if (memory->glushkov.nullable) {
+        return get_bounds(memory, string);
+    }
+    u16 len_tables = (u16)((memory->len_positions + 7) / 8);
+    u64 state = 0;
+    for (u16 i = 0; i < string.len; ++i) {
+        u64 next = memory->glushkov.first;
+        for (u16 j = 0; j < len_tables; ++j) {
+            next |= memory->follow_tables[j][(state >> (8 * j)) & 0xFF];
+        }
+        state = next & memory->positions[(u8)string.chars[i]];
+        if (state & memory->glushkov.last) {
+            return get_bounds(memory, string);
+        }
+    }
+    return (Bounds){0};
+}
+
+static Bounds search_auto(Memory* memory, String string) {
+    switch (memory->engine) {
+    case ENGINE_DFA: {
+        return search_dfa(memory, string);
+    }
+    case ENGINE_GLUSHKOV: {
+        return search_glushkov(memory, string);
+    }
+    default: {
+        ERROR();
+    }
+    }
+}
+
+static Bounds search_reverse(Memory* memory, String string) {
+    EXIT_IF(memory->len_reverse_insts == 0);
+    if (memory->len_counters != 0) {
+        return get_bounds(memory, string);
+    }
+    u16 first = find_literal(memory, string, 0);
+    if (string.len <= first) {
+        return (Bounds){0};
+    }
+    u64    groups[CAP_INSTS];
+    u16    len_groups = 0;
+    Bounds result = {0};
+    for (u16 i = memory->literal_prefix ? first : 0; i <= string.len; ++i) {
+        if (memory->literal_prefix && (!result.match) && (len_groups == 0)) {
+            i = find_literal(memory, string, i);
+            if (string.len <= i) {
+                break;
+            }
+        }
+        if ((!result.match) && (i < string.len)) {
+            u64 seed = memory->closures[0];
+            for (u16 j = 0; j < len_groups; ++j) {
+                seed &= ~groups[j];
+            }
+            if (seed != 0) {
+                groups[len_groups++] = seed;
+            }
+        }
+        for (u16 j = 0; j < len_groups; ++j) {
+            if (groups[j] & memory->match_insts) {
+                result.end = i;
+                result.match = TRUE;
+                len_groups = (u16)(j + 1);
+                break;
+            }
+        }
+        if ((i == string.len) || (result.match && (len_groups == 0))) {
+            break;
+        }
+        u64 seen = 0;
+        u16 len_next = 0;
+        for (u16 j = 0; j < len_groups; ++j) {
+            u64 next = step_anchored(memory->insts,
+                                     memory->closures,
+                                     groups[j],
+                                     (u8)string.chars[i]);
+            next &= ~seen;
+            if (next != 0) {
+                seen |= next;
+                groups[len_next++] = next;
+            }
+        }
+        len_groups = len_next;
+    }
+    if (!result.match) {
+        return result;
+    }
+    u64 insts = memory->reverse_closures[0];
+    for (u16 i = (u16)result.end;; --i) {
+        if (insts & memory->reverse_match_insts) {
+            result.start = i;
+        }
+        if ((i == 0) || (insts == 0)) {
+            break;
+        }
+        insts = step_anchored(memory->reverse_insts,
+                              memory->reverse_closures,
+                              insts,
+                              (u8)string.chars[i - 1]);
+    }
+    return result;
+}
+
+static void push_jit(Memory* memory, const u8* bytes, u32 len) {
+    EXIT_IF(CAP_JIT < (memory->len_jit + len));
+    memcpy(&memory->jit[memory->len_jit], bytes, len);
+    memory->len_jit += len;
+}
+
+#define PUSH_JIT(...)                                \
+    {                                                \
+        const u8 bytes[] = {__VA_ARGS__};            \
+        push_jit(memory, bytes, (u32)sizeof(bytes)); \
+    }
+
+#define PUSH_JIT_U64(x)                                        \
+    {                                                          \
+        u64 bytes = x;                                         \
+        push_jit(memory, (const u8*)&bytes, (u32)sizeof(u64)); \
+    }
+
+#define PATCH_JIT_REL32(from, to)                  \
+    {                                              \
+        i32 rel32 = (i32)(to) - (i32)((from) + 4); \
+        memcpy(&memory->jit[from], &rel32, 4);     \
+    }
+
+static void compile_jit(Memory* memory) {
+    if (memory->len_counters != 0) {
+        return;
+    }
+    if (!memory->jit) {
+        void* address = mmap(NULL,
+                             CAP_JIT,
+                             PROT_READ | PROT_WRITE,
+                             MAP_ANONYMOUS | MAP_PRIVATE,
+                             -1,
+                             0);
+        if (address == MAP_FAILED) {
+            return;
+        }
+        memory->jit = address;
+    } else {
+        EXIT_IF(mprotect(memory->jit, CAP_JIT, PROT_READ | PROT_WRITE));
+    }
+    memory->len_jit = 0;
+    // NOTE: `xor ecx, ecx`, `mov rax, imm64`
+    PUSH_JIT(0x31, 0xC9, 0x48, 0xB8);
+    PUSH_JIT_U64(memory->closures[0]);
+    u32 loop = memory->len_jit;
+    // NOTE: `cmp rcx, rsi`, `jae rel32`
+    PUSH_JIT(0x48, 0x39, 0xF1, 0x0F, 0x83);
+    u32 jump_done = memory->len_jit;
+    PUSH_JIT(0x00, 0x00, 0x00, 0x00);
+    // NOTE: `movzx edx, byte [rdi + rcx]`, `mov r8, imm64`
+    PUSH_JIT(0x0F, 0xB6, 0x14, 0x0F, 0x49, 0xB8);
+    PUSH_JIT_U64(memory->closures[0]);
+    for (u16 i = 0; i < memory->len_insts; ++i) {
+        Inst inst = memory->insts[i];
+        if (inst.tag != INST_CHAR) {
+            continue;
+        }
+        // NOTE: `bt rax, imm8`, `jnc rel8`, `cmp dl, imm8`, `jne rel8`,
+        // `mov r9, imm64`, `or r8, r9`
+        PUSH_JIT(0x48, 0x0F, 0xBA, 0xE0, (u8)i, 0x73, 18);
+        PUSH_JIT(0x80, 0xFA, (u8)inst.op.as_char, 0x75, 13, 0x49, 0xB9);
+        PUSH_JIT_U64(memory->closures[i + 1]);
+        PUSH_JIT(0x4D, 0x09, 0xC8);
+    }
+    // NOTE: `mov rax, r8`, `inc rcx`, `mov r9, imm64`
+    PUSH_JIT(0x4C, 0x89, 0xC0, 0x48, 0xFF, 0xC1, 0x49, 0xB9);
+    PUSH_JIT_U64(memory->match_insts);
+    // NOTE: `test rax, r9`, `jnz rel32`
+    PUSH_JIT(0x4C, 0x85, 0xC8, 0x0F, 0x85);
+    u32 jump_match = memory->len_jit;
+    PUSH_JIT(0x00, 0x00, 0x00, 0x00);
+    // NOTE: `jmp rel32`
+    PUSH_JIT(0xE9);
+    u32 jump_loop = memory->len_jit;
+    PUSH_JIT(0x00, 0x00, 0x00, 0x00);
+    PATCH_JIT_REL32(jump_loop, loop);
+    // NOTE: `xor eax, eax`, `ret`
+    PATCH_JIT_REL32(jump_done, memory->len_jit);
+    PUSH_JIT(0x31, 0xC0, 0xC3);
+    // NOTE: `mov eax, 1`, `ret`
+    PATCH_JIT_REL32(jump_match, memory->len_jit);
+    PUSH_JIT(0xB8, 0x01, 0x00, 0x00, 0x00, 0xC3);
+    EXIT_IF(mprotect(memory->jit, CAP_JIT, PROT_READ | PROT_EXEC));
+}
+
+static Bounds search_jit(Memory* memory, String string) {
+    if (memory->len_jit == 0) {
+        return search_auto(memory, string);
+    }
+    if (string.len <= find_literal(memory, string, 0)) {
+        return (Bounds){0};
+    }
+    if ((memory->closures[0] & memory->match_insts) ||
+        ((JitFn)(void*)memory->jit)(string.chars, string.len))
+    {
+        return get_bounds(memory, string);
+    }
+    return (Bounds){0};
+}
+
+// NOTE: At most one thread per line (per count on a `repeat` line), kept in
+// order of `start`.
+static void start_stream(Stream* stream) {
+    stream->threads[0].flags = 0;
+    stream->threads[0].len = 0;
+    stream->threads[1].flags = 0;
+    stream->threads[1].len = 0;
+    stream->result = (Bounds){0};
+    stream->offset = 0;
+    stream->limit = OFFSET_NONE;
+    stream->current = 0;
+    stream->done = FALSE;
+}
+
+static Bool push_counts(StreamThreads* threads, u16 index, u64* counts) {
+    if ((threads->flags >> index) & 1lu) {
+        *counts &= ~threads->counts[index];
+        if (*counts == 0) {
+            return FALSE;
+        }
+        threads->counts[index] |= *counts;
+    } else {
+        threads->flags |= 1lu << index;
+        threads->counts[index] = *counts;
+    }
+    return TRUE;
+}
+
+static void push_stream(Memory*        memory,
+                        StreamThreads* threads,
+                        u16            index,
+                        u64            start,
+                        u64            counts) {
+    if (!push_counts(threads, index, &counts)) {
+        return;
+    }
+    Inst inst = memory->insts[index];
+    switch (inst.tag) {
+    case INST_MATCH:
+    case INST_CHAR:
+    case INST_REPEAT: {
+        EXIT_IF(CAP_THREADS <= threads->len);
+        threads->buffer[threads->len++] = (Thread){
+            .start = start,
+            .counts = counts,
+            .index = index,
+        };
+        if ((inst.tag == INST_REPEAT) &&
+            is_counted(&memory->counters[inst.op.as_counter], counts))
+        {
+            push_stream(memory, threads, index + 1, start, COUNTS_ZERO);
+        }
+        break;
+    }
+    case INST_JUMP: {
+        push_stream(memory, threads, inst.op.as_line[0], start, COUNTS_ZERO);
+        break;
+    }
+    case INST_SPLIT: {
+        push_stream(memory, threads, inst.op.as_line[0], start, COUNTS_ZERO);
+        push_stream(memory, threads, inst.op.as_line[1], start, COUNTS_ZERO);
+        break;
+    }
+    case INST_SAVE: {
+        push_stream(memory, threads, index + 1, start, COUNTS_ZERO);
+        break;
+    }
+    default: {
+        ERROR();
+    }
+    }
+}
+
+static void step_stream(Memory*        memory,
+                        Stream*        stream,
+                        StreamThreads* current,
+                        StreamThreads* next,
+                        const char*    char_) {
+    for (u16 i = 0; i < current->len; ++i) {
+        Thread thread = current->buffer[i];
+        if (stream->result.match && (stream->result.start < thread.start)) {
+            break;
+        }
+        Inst inst = memory->insts[thread.index];
+        switch (inst.tag) {
+        case INST_CHAR: {
+            if (char_ && (*char_ == inst.op.as_char)) {
+                push_stream(memory,
+                            next,
+                            thread.index + 1,
+                            thread.start,
+                            COUNTS_ZERO);
+            }
+            break;
+        }
+        case INST_REPEAT: {
+            u64 counts =
+                char_ ? step_counts(&memory->counters[inst.op.as_counter],
+                                    thread.counts,
+                                    (u8)*char_)
+                      : 0;
+            if (counts != 0) {
+                push_stream(memory, next, thread.index, thread.start, counts);
+            }
+            break;
+        }
+        case INST_MATCH: {
+            if ((!stream->result.match) ||
+                (thread.start < stream->result.start))
+            {
+                stream->result = (Bounds){
+                    .start = thread.start,
+                    .end = stream->offset,
+                    .match = TRUE,
+                };
+            } else if ((thread.start == stream->result.start) &&
+                       (stream->result.end < stream->offset))
+            {
+                stream->result.end = stream->offset;
+            }
+            break;
+        }
+        case INST_JUMP:
+        case INST_SPLIT:
+        case INST_SAVE:
+        default: {
+            ERROR();
+        }
+        }
+    }
+}
+
+static Bool push_chunk(Memory* memory, Stream* stream, String chunk) {
+    for (u16 i = 0; (i < chunk.len) && (!stream->done); ++i) {
+        StreamThreads* current = &stream->threads[stream->current];
+        StreamThreads* next = &stream->threads[stream->current ^ 1];
+        if ((!stream->result.match) && (stream->offset < stream->limit)) {
+            push_stream(memory, current, 0, stream->offset, COUNTS_ZERO);
+        }
+        step_stream(memory, stream, current, next, &chunk.chars[i]);
+        current->flags = 0;
+        current->len = 0;
+        stream->current ^= 1;
+        ++stream->offset;
+        stream->done =
+            (stream->result.match || (stream->limit <= stream->offset)) &&
+            (next->len == 0);
+    }
+    return stream->done;
+}
+
+static Bounds stop_stream(Memory* memory, Stream* stream) {
+    if (!stream->done) {
+        StreamThreads* current = &stream->threads[stream->current];
+        step_stream(memory, stream, current, NULL, NULL);
+        stream->done = TRUE;
+    }
+    return stream->result;
+}
+
+static Bounds search_stream(Memory* memory, const char* chars, u64 len) {
+    Stream stream;
+    start_stream(&stream);
+    for (u64 i = 0; i < len; i += CAP_CHUNK) {
+        String chunk = {
+            .chars = &chars[i],
+            .len = (u16)(CAP_CHUNK < (len - i) ? CAP_CHUNK : (len - i)),
+        };
+        if (push_chunk(memory, &stream, chunk)) {
+            break;
+        }
+    }
+    return stop_stream(memory, &stream);
+}
+
+// NOTE: `search()` tracks thread starts in a `u64`, so it only takes strings
+// shorter than `CAP_STRING`.
+static Bounds get_bounds(Memory* memory, String string) {
+    if (string.len < CAP_STRING) {
+        return search(memory, string);
+    }
+    if ((memory->len_reverse_insts != 0) && (memory->len_counters == 0)) {
+        return search_reverse(memory, string);
+    }
+    return search_stream(memory, string.chars, string.len);
+}
+
+static void atomic_min(u64Atomic* atomic, u64 x) {
+    u64 prev = atomic_load(atomic);
+    while ((x < prev) && (!atomic_compare_exchange_weak(atomic, &prev, x))) {
+    }
+}
+
+// NOTE: A worker only seeds inside its own slice but reads past its end until
+// its threads settle, giving up after `CAP_OVERLAP` bytes.
+static void* do_work(void* args) {
+    Payload* payload = args;
+    Job*     job = payload->job;
+    for (;;) {
+        u64 index = atomic_fetch_add(&job->index, 1);
+        if ((job->len_slices <= index) || (atomic_load(&job->found) < index)) {
+            return NULL;
+        }
+        Stream stream;
+        start_stream(&stream);
+        stream.offset = index * CAP_SLICE;
+        stream.limit = stream.offset + CAP_SLICE;
+        u64  end = stream.limit + CAP_OVERLAP;
+        Bool skip = FALSE;
+        if (job->len < end) {
+            end = job->len;
+        }
+        for (u64 i = stream.offset; (i < end) && (!stream.done);
+             i += CAP_CHUNK)
+        {
+            if (atomic_load(&job->found) < index) {
+                skip = TRUE;
+                break;
+            }
+            String chunk = {
+                .chars = &job->chars[i],
+                .len = (u16)(CAP_CHUNK < (end - i) ? CAP_CHUNK : (end - i)),
+            };
+            push_chunk(job->memory, &stream, chunk);
+        }
+        if (skip) {
+            continue;
+        }
+        Bool   settled = stream.done || (end == job->len);
+        Bounds result = stop_stream(job->memory, &stream);
+        if (settled && (!result.match)) {
+            continue;
+        }
+        atomic_min(&job->found, index);
+        if (((!payload->result.match) && payload->settled) ||
+            (index < payload->slice))
+        {
+            payload->result = result;
+            payload->slice = index;
+            payload->settled = settled;
+        }
+    }
+}
+
+static Bounds search_parallel(Memory*     memory,
+                              const char* chars,
+                              u64         len,
+                              u16         len_workers) {
+    EXIT_IF((len_workers == 0) || (CAP_WORKERS < len_workers));
+    Job job = {
+        .memory = memory,
+        .chars = chars,
+        .len = len,
+        .len_slices = (len + CAP_SLICE - 1) / CAP_SLICE,
+    };
+    atomic_init(&job.index, 0);
+    atomic_init(&job.found, OFFSET_NONE);
+    pthread_t workers[CAP_WORKERS];
+    Payload   payloads[CAP_WORKERS];
+    for (u16 i = 0; i < len_workers; ++i) {
+        payloads[i] = (Payload){
+            .job = &job,
+            .result = {0},
+            .slice = 0,
+            .settled = TRUE,
+        };
+        EXIT_IF(pthread_create(&workers[i], NULL, do_work, &payloads[i]));
+    }
+    Bounds result = {0};
+    u64    slice = OFFSET_NONE;
+    Bool   settled = TRUE;
+    for (u16 i = 0; i < len_workers; ++i) {
+        EXIT_IF(pthread_join(workers[i], NULL));
+        if ((payloads[i].result.match || (!payloads[i].settled)) &&
+            (payloads[i].slice < slice))
+        {
+            result = payloads[i].result;
+            slice = payloads[i].slice;
+            settled = payloads[i].settled;
+        }
+    }
+    if (settled) {
+        return result;
+    }
+    u64 offset = slice * CAP_SLICE;
+    result = search_stream(memory, &chars[offset], len - offset);
+    if (result.match) {
+        result.start += offset;
+        result.end += offset;
+    }
+    return result;
+}
+
+static u16 alloc_captures(Memory* memory) {
+    EXIT_IF(memory->len_free_captures == 0);
+    u16 index = memory->free_captures[--memory->len_free_captures];
+    memory->captures[index].refs = 1;
+    return index;
+}
+
+static void release_captures(Memory* memory, u16 index) {
+    if (--memory->captures[index].refs == 0) {
+        memory->free_captures[memory->len_free_captures++] = index;
+    }
+}
+
+static u16 write_captures(Memory* memory, u16 index, u16 slot, u64 offset) {
+    if (1 < memory->captures[index].refs) {
+        u16 copy = alloc_captures(memory);
+        memcpy(&memory->captures[copy].slots[0],
+               &memory->captures[index].slots[0],
+               sizeof(memory->captures[index].slots));
+        --memory->captures[index].refs;
+        index = copy;
+    }
+    memory->captures[index].slots[slot] = offset;
+    return index;
+}
+
+static void push_groups(Memory*        memory,
+                        StreamThreads* threads,
+                        Thread         thread,
+                        u64            offset) {
+    if (!push_counts(threads, thread.index, &thread.counts)) {
+        release_captures(memory, thread.captures);
+        return;
+    }
+    Inst inst = memory->insts[thread.index];
+    switch (inst.tag) {
+    case INST_MATCH:
+    case INST_CHAR: {
+        threads->buffer[threads->len++] = thread;
+        break;
+    }
+    case INST_REPEAT: {
+        EXIT_IF(CAP_THREADS <= threads->len);
+        threads->buffer[threads->len++] = thread;
+        if (is_counted(&memory->counters[inst.op.as_counter], thread.counts)) {
+            ++memory->captures[thread.captures].refs;
+            ++thread.index;
+            thread.counts = COUNTS_ZERO;
+            push_groups(memory, threads, thread, offset);
+        }
+        break;
+    }
+    case INST_JUMP: {
+        thread.index = inst.op.as_line[0];
+        thread.counts = COUNTS_ZERO;
+        push_groups(memory, threads, thread, offset);
+        break;
+    }
+    case INST_SPLIT: {
+        ++memory->captures[thread.captures].refs;
+        Thread other = thread;
+        thread.index = inst.op.as_line[0];
+        other.index = inst.op.as_line[1];
+        thread.counts = COUNTS_ZERO;
+        other.counts = COUNTS_ZERO;
+        push_groups(memory, threads, thread, offset);
+        push_groups(memory, threads, other, offset);
+        break;
+    }
+    case INST_SAVE: {
+        thread.captures =
+            write_captures(memory, thread.captures, inst.op.as_slot, offset);
+        ++thread.index;
+        thread.counts = COUNTS_ZERO;
+        push_groups(memory, threads, thread, offset);
+        break;
+    }
+    default: {
+        ERROR();
+    }
+    }
+}
+
+static Bounds search_groups(Memory* memory, String string, Bounds* groups) {
+    EXIT_IF(CAP_GROUPS < memory->len_groups);
+    memory->len_free_captures = 0;
+    for (u16 i = 0; i < CAP_CAPTURES; ++i) {
+        memory->free_captures[memory->len_free_captures++] = i;
+    }
+    StreamThreads  threads[2];
+    StreamThreads* current = &threads[0];
+    StreamThreads* next = &threads[1];
+    current->flags = 0;
+    current->len = 0;
+    Bounds result = {0};
+    u16    captures = 0;
+    for (u16 i = 0; i <= string.len; ++i) {
+        if ((!result.match) && (i < string.len)) {
+            u16 index = alloc_captures(memory);
+            for (u16 j = 0; j < CAP_SLOTS; ++j) {
+                memory->captures[index].slots[j] = SLOT_NONE;
+            }
+            Thread thread = {
+                .start = i,
+                .counts = COUNTS_ZERO,
+                .index = 0,
+                .captures = index,
+            };
+            push_groups(memory, current, thread, i);
+        }
+        next->flags = 0;
+        next->len = 0;
+        for (u16 j = 0; j < current->len; ++j) {
+            Thread thread = current->buffer[j];
+            if (result.match && (result.start < thread.start)) {
+                release_captures(memory, thread.captures);
+                continue;
+            }
+            Inst inst = memory->insts[thread.index];
+            switch (inst.tag) {
+            case INST_CHAR: {
+                if ((i < string.len) && (string.chars[i] == inst.op.as_char)) {
+                    ++thread.index;
+                    thread.counts = COUNTS_ZERO;
+                    push_groups(memory, next, thread, i + 1);
+                } else {
+                    release_captures(memory, thread.captures);
+                }
+                break;
+            }
+            case INST_REPEAT: {
+                thread.counts =
+                    i < string.len
+                        ? step_counts(&memory->counters[inst.op.as_counter],
+                                      thread.counts,
+                                      (u8)string.chars[i])
+                        : 0;
+                if (thread.counts != 0) {
+                    push_groups(memory, next, thread, i + 1);
+                } else {
+                    release_captures(memory, thread.captures);
+                }
+                break;
+            }
+            case INST_MATCH: {
+                if ((!result.match) || (thread.start < result.start) ||
+                    ((thread.start == result.start) && (result.end < i)))
+                {
+                    if (result.match) {
+                        release_captures(memory, captures);
+                    }
+                    result = (Bounds){
+                        .start = thread.start,
+                        .end = i,
+                        .match = TRUE,
+                    };
+                    captures = thread.captures;
+                } else {
+                    release_captures(memory, thread.captures);
+                }
+                break;
+            }
+            case INST_JUMP:
+            case INST_SPLIT:
+            case INST_SAVE:
+            default: {
+                ERROR();
+            }
+            }
+        }
+        StreamThreads* swap = current;
+        current = next;
+        next = swap;
+        if (result.match && (current->len == 0)) {
+            break;
+        }
+    }
+    for (u16 i = 0; i < memory->len_groups; ++i) {
+        groups[i] = (Bounds){0};
+        if (!result.match) {
+            continue;
+        }
+        u64 start = memory->captures[captures].slots[2 * i];
+        u64 end = memory->captures[captures].slots[(2 * i) + 1];
+        if ((start != SLOT_NONE) && (end != SLOT_NONE)) {
+            groups[i] = (Bounds){
+                .start = start,
+                .end = end,
+                .match = TRUE,
+            };
+        }
+    }
+    return result;
+}
+
+static void start_iterator(Iterator* iterator, String string) {
+    iterator->threads[0].flags = 0;
+    iterator->threads[0].len = 0;
+    iterator->threads[1].flags = 0;
+    iterator->threads[1].len = 0;
+    iterator->last = (Bounds){0};
+    iterator->string = string;
+    iterator->len_pending = 0;
+    iterator->offset = 0;
+    iterator->current = 0;
+    iterator->done = FALSE;
+}
+
+static Bool is_overlapped(Iterator* iterator, u64 start) {
+    if (iterator->last.match && (start < iterator->last.end)) {
+        return TRUE;
+    }
+    for (u16 i = 0; i < iterator->len_pending; ++i) {
+        if ((iterator->pending[i].start < start) &&
+            (start < iterator->pending[i].end))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static void push_pending(Iterator* iterator, u64 start, u64 end) {
+    u16 i = iterator->len_pending;
+    while ((i != 0) && (start < iterator->pending[i - 1].start)) {
+        --i;
+    }
+    if ((i != 0) && (iterator->pending[i - 1].start == start)) {
+        iterator->pending[i - 1].end = end;
+        iterator->len_pending = i;
+        return;
+    }
+    Bounds prev = i != 0 ? iterator->pending[i - 1] : iterator->last;
+    if ((start == end) && prev.match && (prev.end == start)) {
+        return;
+    }
+    EXIT_IF(CAP_PENDING <= i);
+    iterator->pending[i] = (Bounds){
+        .start = start,
+        .end = end,
+        .match = TRUE,
+    };
+    iterator->len_pending = (u16)(i + 1);
+}
+
+static void step_iterator(Memory* memory, Iterator* iterator) {
+    StreamThreads* current = &iterator->threads[iterator->current];
+    StreamThreads* next = &iterator->threads[iterator->current ^ 1];
+    u16            offset = iterator->offset;
+    Bool           end = iterator->string.len <= offset;
+    u16            len = 0;
+    current->flags = 0;
+    for (u16 i = 0; i < current->len; ++i) {
+        Thread thread = current->buffer[i];
+        if (is_overlapped(iterator, thread.start)) {
+            continue;
+        }
+        if (memory->insts[thread.index].tag == INST_MATCH) {
+            push_pending(iterator, thread.start, offset);
+        } else if (push_counts(current, thread.index, &thread.counts)) {
+            current->buffer[len++] = thread;
+        }
+    }
+    current->len = len;
+    if (!end) {
+        push_stream(memory, current, 0, offset, COUNTS_ZERO);
+    }
+    for (u16 i = 0; i < current->len; ++i) {
+        Thread thread = current->buffer[i];
+        if (is_overlapped(iterator, thread.start)) {
+            continue;
+        }
+        Inst inst = memory->insts[thread.index];
+        switch (inst.tag) {
+        case INST_CHAR: {
+            if ((!end) && (iterator->string.chars[offset] == inst.op.as_char))
+            {
+                push_stream(memory,
+                            next,
+                            thread.index + 1,
+                            thread.start,
+                            COUNTS_ZERO);
+            }
+            break;
+        }
+        case INST_REPEAT: {
+            u64 counts =
+                end ? 0
+                    : step_counts(&memory->counters[inst.op.as_counter],
+                                  thread.counts,
+                                  (u8)iterator->string.chars[offset]);
+            if (counts != 0) {
+                push_stream(memory, next, thread.index, thread.start, counts);
+            }
+            break;
+        }
+        case INST_MATCH: {
+            push_pending(iterator, thread.start, offset);
+            break;
+        }
+        case INST_JUMP:
+        case INST_SPLIT:
+        case INST_SAVE:
+        default: {
+            ERROR();
+        }
+        }
+    }
+    current->flags = 0;
+    current->len = 0;
+    iterator->current ^= 1;
+    if (end) {
+        iterator->done = TRUE;
+    } else {
+        ++iterator->offset;
+    }
+}
+
+static u16 next_matches(Memory*   memory,
+                        Iterator* iterator,
+                        Bounds*   buffer,
+                        u16       cap) {
+    u16 len = 0;
+    for (;;) {
+        StreamThreads* threads = &iterator->threads[iterator->current];
+        u16            settled = iterator->len_pending;
+        if ((!iterator->done) && (threads->len != 0)) {
+            settled = 0;
+            while ((settled < iterator->len_pending) &&
+                   (iterator->pending[settled].start <
+                    threads->buffer[0].start))
+            {
+                ++settled;
+            }
+        }
+        if (cap < (len + settled)) {
+            settled = (u16)(cap - len);
+        }
+        if (settled != 0) {
+            memcpy(&buffer[len], iterator->pending, sizeof(Bounds) * settled);
+            len = (u16)(len + settled);
+            iterator->last = iterator->pending[settled - 1];
+            iterator->len_pending = (u16)(iterator->len_pending - settled);
+            memmove(iterator->pending,
+                    &iterator->pending[settled],
+                    sizeof(Bounds) * iterator->len_pending);
+        }
+        if ((len == cap) || (iterator->done && (iterator->len_pending == 0)))
+        {
+            return len;
+        }
+        step_iterator(memory, iterator);
+    }
+}
+
+// NOTE: State `0` is the dead state and state `1` the start state.
+static u16 get_lexer_state(Memory* memory, Lexer* lexer, u64 insts) {
+    for (u16 i = 0; i < lexer->len_states; ++i) {
+        if (lexer->insts[i] == insts) {
+            return i;
+        }
+    }
+    EXIT_IF(CAP_DFA <= lexer->len_states);
+    u16 index = lexer->len_states++;
+    u64 matches = get_matches(memory, insts);
+    lexer->insts[index] = insts;
+    lexer->rules[index] =
+        matches != 0 ? (u16)__builtin_ctzl(matches) : RULE_NONE;
+    return index;
+}
+
+static void minimize_lexer(Lexer* lexer) {
+    u16 blocks[CAP_DFA];
+    u16 next_blocks[CAP_DFA];
+    u16 firsts[CAP_DFA];
+    u16 len_blocks = 0;
+    for (u16 i = 0; i < lexer->len_states; ++i) {
+        u16 j = 0;
+        for (; j < len_blocks; ++j) {
+            if (lexer->rules[firsts[j]] == lexer->rules[i]) {
+                break;
+            }
+        }
+        if (j == len_blocks) {
+            firsts[len_blocks++] = i;
+        }
+        blocks[i] = j;
+    }
+    for (;;) {
+        u16 len_next_blocks = 0;
+        for (u16 i = 0; i < lexer->len_states; ++i) {
+            u16 j = 0;
+            for (; j < len_next_blocks; ++j) {
+                u16 first = firsts[j];
+                if (blocks[first] != blocks[i]) {
+                    continue;
+                }
+                u16 k = 0;
+                for (; k < CAP_BYTES; ++k) {
+                    if (blocks[lexer->transitions[first][k]] !=
+                        blocks[lexer->transitions[i][k]])
+                    {
+                        break;
+                    }
+                }
+                if (k == CAP_BYTES) {
+                    break;
+                }
+            }
+            if (j == len_next_blocks) {
+                firsts[len_next_blocks++] = i;
+            }
+            next_blocks[i] = j;
+        }
+        memcpy(blocks, next_blocks, sizeof(u16) * lexer->len_states);
+        if (len_next_blocks == len_blocks) {
+            break;
+        }
+        len_blocks = len_next_blocks;
+    }
+    for (u16 i = 0; i < len_blocks; ++i) {
+        u16 first = firsts[i];
+        lexer->insts[i] = lexer->insts[first];
+        lexer->rules[i] = lexer->rules[first];
+        for (u16 j = 0; j < CAP_BYTES; ++j) {
+            lexer->transitions[i][j] = blocks[lexer->transitions[first][j]];
+        }
+    }
+    lexer->len_states = len_blocks;
+}
+
+static void set_lexer_classes(Lexer* lexer) {
+    u16 firsts[CAP_BYTES];
+    lexer->len_classes = 0;
+    for (u16 i = 0; i < CAP_BYTES; ++i) {
+        u16 j = 0;
+        for (; j < lexer->len_classes; ++j) {
+            u16 k = 0;
+            for (; k < lexer->len_states; ++k) {
+                if (lexer->transitions[k][firsts[j]] !=
+                    lexer->transitions[k][i])
+                {
+                    break;
+                }
+            }
+            if (k == lexer->len_states) {
+                break;
+            }
+        }
+        if (j == lexer->len_classes) {
+            firsts[lexer->len_classes++] = i;
+        }
+        lexer->classes[i] = (u8)j;
+    }
+}
+
+static void set_lexer(Memory*       memory,
+                      Lexer*        lexer,
+                      const String* regexes,
+                      u16           len) {
+    compile_set(memory, regexes, len);
+    lexer->len_states = 0;
+    EXIT_IF(get_lexer_state(memory, lexer, 0) != 0);
+    EXIT_IF(get_lexer_state(memory, lexer, memory->closures[0]) != 1);
+    for (u16 i = 0; i < lexer->len_states; ++i) {
+        for (u16 j = 0; j < CAP_BYTES; ++j) {
+            u64 next = step_anchored(memory->insts,
+                                     memory->closures,
+                                     lexer->insts[i],
+                                     (u8)j);
+            lexer->transitions[i][j] = get_lexer_state(memory, lexer, next);
+        }
+    }
+    minimize_lexer(lexer);
+    set_lexer_classes(lexer);
+}
+
+static u16 scan_lexer(Lexer* lexer, String string, u16* rule) {
+    u16 end = 0;
+    u16 state = 1;
+    for (u16 i = 0;;) {
+        if (lexer->rules[state] != RULE_NONE) {
+            end = i;
+            *rule = lexer->rules[state];
+        }
+        if ((i == string.len) || (state == 0)) {
+            break;
+        }
+        state = lexer->transitions[state][(u8)string.chars[i++]];
+    }
+    return end;
+}
+
+static void show_lexer_byte(u16 byte) {
+    if ((('0' <= byte) && (byte <= '9')) || (('A' <= byte) && (byte <= 'Z')) ||
+        (('a' <= byte) && (byte <= 'z')))
+    {
+        printf("'%c'", (char)byte);
+    } else {
+        printf("%hu", byte);
+    }
+}
+
+static void show_lexer_switch(Lexer* lexer, const u16* ids) {
+    printf("static uint32_t lex(const char* chars, uint32_t len, "
+           "uint16_t* token) {\n"
+           "    uint32_t end = 0;\n"
+           "    uint32_t i = 0;\n");
+    for (u16 i = 1; i < lexer->len_states; ++i) {
+        Bool jumped = i != 1;
+        for (u16 j = 0; (j < lexer->len_states) && (!jumped); ++j) {
+            for (u16 k = 0; k < CAP_BYTES; ++k) {
+                if (lexer->transitions[j][k] == i) {
+                    jumped = TRUE;
+                    break;
+                }
+            }
+        }
+        if (jumped) {
+            printf("state_%hu:\n", i);
+        }
+        if (lexer->rules[i] != RULE_NONE) {
+            printf("    end = i;\n"
+                   "    *token = %hu;\n",
+                   ids[lexer->rules[i]]);
+        }
+        printf("    if (i == len) {\n"
+               "        return end;\n"
+               "    }\n"
+               "    switch ((uint8_t)chars[i++]) {\n");
+        for (u16 j = 1; j < lexer->len_states; ++j) {
+            Bool any = FALSE;
+            for (u16 k = 0; k < CAP_BYTES; ++k) {
+                if (lexer->transitions[i][k] == j) {
+                    printf("    case ");
+                    show_lexer_byte(k);
+                    printf(":\n");
+                    any = TRUE;
+                }
+            }
+            if (any) {
+                printf("        goto state_%hu;\n", j);
+            }
+        }
+        printf("    default:\n"
+               "        return end;\n"
+               "    }\n");
+    }
+    printf("}\n");
+}
+
+static void show_lexer_table(Lexer* lexer, const u16* ids) {
+    printf("static const uint8_t LEX_CLASSES[256] = {");
+    for (u16 i = 0; i < CAP_BYTES; ++i) {
+        printf("%s%hhu,", (i % 16) == 0 ? "\n    " : " ", lexer->classes[i]);
+    }
+    printf("\n};\n\n"
+           "static const uint8_t LEX_TRANSITIONS[%hu][%hu] = {\n",
+           lexer->len_states,
+           lexer->len_classes);
+    for (u16 i = 0; i < lexer->len_states; ++i) {
+        printf("    {");
+        u16 class = 0;
+        for (u16 j = 0; j < CAP_BYTES; ++j) {
+            if (lexer->classes[j] == class) {
+                printf("%s%hu", j == 0 ? "" : ", ", lexer->transitions[i][j]);
+                ++class;
+            }
+        }
+        printf("},\n");
+    }
+    printf("};\n\n"
+           "static const uint16_t LEX_TOKENS[%hu] = {",
+           lexer->len_states);
+    for (u16 i = 0; i < lexer->len_states; ++i) {
+        printf("%s%hu,",
+               (i % 8) == 0 ? "\n    " : " ",
+               lexer->rules[i] != RULE_NONE ? ids[lexer->rules[i]]
+                                            : RULE_NONE);
+    }
+    printf("\n};\n\n"
+           "static uint32_t lex(const char* chars, uint32_t len, "
+           "uint16_t* token) {\n"
+           "    uint32_t end = 0;\n"
+           "    uint8_t  state = 1;\n"
+           "    for (uint32_t i = 0;;) {\n"
+           "        if (LEX_TOKENS[state] != %hu) {\n"
+           "            end = i;\n"
+           "            *token = LEX_TOKENS[state];\n"
+           "        }\n"
+           "        if ((i == len) || (state == 0)) {\n"
+           "            return end;\n"
+           "        }\n"
+           "        state = "
+           "LEX_TRANSITIONS[state][LEX_CLASSES[(uint8_t)chars[i++]]];\n"
+           "    }\n"
+           "}\n",
+           RULE_NONE);
+}
+
+static void show_lexer(i32 len, const char** args, Bool table) {
+    EXIT_IF((len <= 0) || ((len % 2) != 0) || ((2 * CAP_PATTERNS) < len));
+    Memory* memory = calloc(1, sizeof(Memory));
+    EXIT_IF(!memory);
+    Lexer* lexer = calloc(1, sizeof(Lexer));
+    EXIT_IF(!lexer);
+    String regexes[CAP_PATTERNS] = {0};
+    u16    ids[CAP_PATTERNS];
+    u16    len_rules = (u16)(len / 2);
+    for (u16 i = 0; i < len_rules; ++i) {
+        usize len_regex = strlen(args[2 * i]);
+        EXIT_IF(CAP_STRING <= len_regex);
+        regexes[i] = (String){
+            .chars = args[2 * i],
+            .len = (u16)len_regex,
+        };
+        char* end = NULL;
+        u64   id = strtoul(args[(2 * i) + 1], &end, 10);
+        EXIT_IF((*end != '\0') || (RULE_NONE <= id));
+        ids[i] = (u16)id;
+    }
+    set_lexer(memory, lexer, regexes, len_rules);
+    printf("// NOTE: Generated by `$ runc src/regex_vm.c lexer %s`.\n",
+           table ? "table" : "switch");
+    for (u16 i = 0; i < len_rules; ++i) {
+        printf("// NOTE: `%s` -> %hu\n", regexes[i].chars, ids[i]);
+    }
+    printf("\n#include <stdint.h>\n\n");
+    if (table) {
+        show_lexer_table(lexer, ids);
+    } else {
+        show_lexer_switch(lexer, ids);
+    }
+    free(lexer);
+    free(memory);
+}
+
+static Bounds search_chunks(Memory* memory, String string, u16 n) {
+    Stream stream;
+    start_stream(&stream);
+    for (u16 i = 0; i < string.len; i = (u16)(i + n)) {
+        String chunk = {
+            .chars = &string.chars[i],
+            .len = (u16)(n < (string.len - i) ? n : (string.len - i)),
+        };
+        if (push_chunk(memory, &stream, chunk)) {
+            break;
+        }
+    }
+    return stop_stream(memory, &stream);
+}
+
+static u16 find_all(Memory* memory, String string, Bounds* buffer, u16 n) {
+    Iterator iterator;
+    start_iterator(&iterator, string);
+    u16 len = 0;
+    for (;;) {
+        EXIT_IF(CAP_PENDING < (len + n));
+        u16 written = next_matches(memory, &iterator, &buffer[len], n);
+        len = (u16)(len + written);
+        if (written < n) {
+            return len;
+        }
+    }
+}
+
+static u16 find_all_rescan(Memory* memory, String string, Bounds* buffer) {
+    u16 len = 0;
+    for (u64 offset = 0; offset < string.len;) {
+        Bounds result = search_stream(memory,
+                                      &string.chars[offset],
+                                      string.len - offset);
+        if (!result.match) {
+            break;
+        }
+        result.start += offset;
+        result.end += offset;
+        offset = result.start == result.end ? result.end + 1 : result.end;
+        if ((result.start == result.end) && (len != 0) &&
+            (buffer[len - 1].end == result.start))
+        {
+            continue;
+        }
+        EXIT_IF(CAP_PENDING <= len);
+        buffer[len++] = result;
+    }
+    return len;
+}
+
+#define SEARCH(memory, string_literal, start_, end_)               \
+    {                                                              \
+        String string = TO_STRING(string_literal);                 \
+        Bounds result = search(memory, string);                    \
+        EXIT_IF((!result.match) || (result.start != start_) ||     \
+                (result.end != end_));                             \
+        result = search_dfa(memory, string);                       \
+        EXIT_IF((!result.match) || (result.start != start_) ||     \
+                (result.end != end_));                             \
+        result = search_auto(memory, string);                      \
+        EXIT_IF((!result.match) || (result.start != start_) ||     \
+                (result.end != end_));                             \
+        result = search_jit(memory, string);                       \
+        EXIT_IF((!result.match) || (result.start != start_) ||     \
+                (result.end != end_));                             \
+        for (u16 n = 1; n <= string.len; ++n) {                    \
+            result = search_chunks(memory, string, n);             \
+            EXIT_IF((!result.match) || (result.start != start_) || \
+                    (result.end != end_));                         \
+        }                                                          \
+        Bounds groups[CAP_GROUPS];                                 \
+        result = search_groups(memory, string, groups);            \
+        EXIT_IF((!result.match) || (result.start != start_) ||     \
+                (result.end != end_));                             \
+        result = search_reverse(memory, string);                   \
+        EXIT_IF((!result.match) || (result.start != start_) ||     \
+                (result.end != end_));                             \
+        EXIT_IF(find_all(memory, string, groups, 1) == 0);         \
+        EXIT_IF((groups[0].start != start_) ||                     \
+                (groups[0].end != end_));                          \
+        fprintf(stderr, ".");                                      \
+    }
+
+#define NO_SEARCH(memory, string_literal)                     \
+    {                                                         \
+        String string = TO_STRING(string_literal);            \
+        EXIT_IF(search(memory, string).match);                \
+        EXIT_IF(search_dfa(memory, string).match);            \
+        EXIT_IF(search_auto(memory, string).match);           \
+        EXIT_IF(search_jit(memory, string).match);            \
+        u16 n = 1;                                            \
+        do {                                                  \
+            EXIT_IF(search_chunks(memory, string, n).match);  \
+        } while (++n <= string.len);                          \
+        Bounds groups[CAP_GROUPS];                            \
+        EXIT_IF(search_groups(memory, string, groups).match); \
+        EXIT_IF(search_reverse(memory, string).match);        \
+        EXIT_IF(find_all(memory, string, groups, 1) != 0);    \
+        fprintf(stderr, ".");                                 \
+    }
+
+#define FIND_ALL(memory, string_literal, expected)                 \
+    {                                                              \
+        String string = TO_STRING(string_literal);                 \
+        for (u16 n = 1; n <= 4; ++n) {                             \
+            Bounds found[CAP_PENDING];                             \
+            u16    len_found = find_all(memory, string, found, n); \
+            EXIT_IF(len_found != (LEN_ARRAY(expected) / 2));       \
+            for (u16 k = 0; k < len_found; ++k) {                  \
+                EXIT_IF((found[k].start != expected[2 * k]) ||     \
+                        (found[k].end != expected[(2 * k) + 1]));  \
+            }                                                      \
+        }                                                          \
+        fprintf(stderr, ".");                                      \
+    }
+
+#define LEX(lexer, string_literal, len_, rule_)                               \
+    {                                                                         \
+        u16 rule = RULE_NONE;                                                 \
+        EXIT_IF(scan_lexer(lexer, TO_STRING(string_literal), &rule) != len_); \
+        EXIT_IF(rule != rule_);                                               \
+        fprintf(stderr, ".");                                                 \
+    }
+
+#define GROUP(groups, index, start_, end_)                                   \
+    {                                                                        \
+        EXIT_IF((!groups[index].match) || (groups[index].start != start_) || \
+                (groups[index].end != end_));                                \
+        fprintf(stderr, ".");                                                \
+    }
+
+#define NO_GROUP(groups, index)       \
+    {                                 \
+        EXIT_IF(groups[index].match); \
+        fprintf(stderr, ".");         \
+    }
+
+#define PARALLEL(memory, chars, len, match_, start_, end_)          \
+    {                                                               \
+        Bounds expected = search_stream(memory, chars, len);        \
+        EXIT_IF((expected.match != match_) ||                       \
+                (match_ && ((expected.start != start_) ||           \
+                            (expected.end != end_))));              \
+        for (u16 n = 1; n <= CAP_WORKERS; n = (u16)(n * 4)) {       \
+            Bounds result = search_parallel(memory, chars, len, n); \
+            EXIT_IF((result.match != expected.match) ||             \
+                    (result.start != expected.start) ||             \
+                    (result.end != expected.end));                  \
+        }                                                           \
+        fprintf(stderr, ".");                                       \
+    }
+
+#define SEARCH_SET(memory, string_literal, matches)                        \
+    {                                                                      \
+        EXIT_IF(search_set(memory, TO_STRING(string_literal)) != matches); \
+        fprintf(stderr, ".");                                              \
+    }
+
+#define NANO_PER_SECOND 1000000000lu
+#define BENCH_NANO      (NANO_PER_SECOND / 20)
+#define BENCH_SEED      0x2545F491u
+
+#define CAP_CORPUS (1lu << 20)
+#define CAP_LINES  (CAP_CORPUS / 16)
+
+typedef double f64;
+
+typedef struct timespec Time;
+typedef struct rusage   Usage;
+
+typedef Bounds (*SearchFn)(Memory*, String);
+
+typedef struct {
+    char   chars[CAP_CORPUS];
+    String lines[CAP_LINES];
+    u64    len;
+    u32    len_lines;
+} Corpus;
+
+typedef struct {
+    u64 bytes;
+    u64 nanoseconds;
+    u64 iterations;
+    u64 matches;
+} Bench;
+
+static u64 get_monotonic(void) {
+    Time time;
+    EXIT_IF(clock_gettime(CLOCK_MONOTONIC, &time));
+    return (((u64)time.tv_sec) * NANO_PER_SECOND) + ((u64)time.tv_nsec);
+}
+
+NO_INT_SAN static u32 xor_shift_32(u32* state) {
+    u32 x = *state;
+    x ^= x << 13u;
+    x ^= x >> 17u;
+    x ^= x << 5u;
+    *state = x;
+    return x;
+}
+
+static void set_corpus(Corpus* corpus, u64 len, u32 density) {
+    EXIT_IF(CAP_CORPUS < len);
+    u32 rng = BENCH_SEED;
+    corpus->len = 0;
+    corpus->len_lines = 0;
+    while (corpus->len < len) {
+        u64 len_line = 16 + (xor_shift_32(&rng) % 32);
+        if (len < (corpus->len + len_line + 1)) {
+            break;
+        }
+        EXIT_IF(CAP_LINES <= corpus->len_lines);
+        char* line = &corpus->chars[corpus->len];
+        if ((xor_shift_32(&rng) % 1024) < density) {
+            u64 len_e = 1 + (xor_shift_32(&rng) % 8);
+            len_line = 0;
+            line[len_line++] = 'n';
+            for (u64 i = 0; i < len_e; ++i) {
+                line[len_line++] = 'e';
+            }
+            line[len_line++] = 'd';
+            line[len_line++] = 'l';
+            line[len_line++] = 'e';
+        } else {
+            for (u64 i = 0; i < len_line; ++i) {
+                line[i] = "abcd "[xor_shift_32(&rng) % 5];
+            }
+        }
+        corpus->lines[corpus->len_lines++] = (String){
+            .chars = line,
+            .len = (u16)len_line,
+        };
+        line[len_line] = '\n';
+        corpus->len += len_line + 1;
+    }
+}
+
+static Bench bench_corpus(Memory* memory, SearchFn search_fn, Corpus* corpus) {
+    Bench bench = {0};
+    u64   start = get_monotonic();
+    do {
+        bench.matches = 0;
+        for (u32 i = 0; i < corpus->len_lines; ++i) {
+            if (search_fn(memory, corpus->lines[i]).match) {
+                ++bench.matches;
+            }
+        }
+        bench.bytes += corpus->len;
+        ++bench.iterations;
+        bench.nanoseconds = get_monotonic() - start;
+    } while (bench.nanoseconds < BENCH_NANO);
+    return bench;
+}
+
+static Bench bench_find_all(Memory* memory, Corpus* corpus) {
+    Bench    bench = {0};
+    Iterator iterator;
+    Bounds   buffer[CAP_PENDING];
+    u64      start = get_monotonic();
+    do {
+        bench.matches = 0;
+        for (u32 i = 0; i < corpus->len_lines; ++i) {
+            start_iterator(&iterator, corpus->lines[i]);
+            u16 len = CAP_PENDING;
+            while (len == CAP_PENDING) {
+                len = next_matches(memory, &iterator, buffer, CAP_PENDING);
+                bench.matches += len;
+            }
+        }
+        bench.bytes += corpus->len;
+        ++bench.iterations;
+        bench.nanoseconds = get_monotonic() - start;
+    } while (bench.nanoseconds < BENCH_NANO);
+    return bench;
+}
+
+static Bench bench_string(Memory* memory, SearchFn search_fn, String string) {
+    Bench bench = {0};
+    u64   start = get_monotonic();
+    do {
+        bench.matches = search_fn(memory, string).match ? 1 : 0;
+        bench.bytes += string.len;
+        ++bench.iterations;
+        bench.nanoseconds = get_monotonic() - start;
+    } while (bench.nanoseconds < BENCH_NANO);
+    return bench;
+}
+
+static Bench bench_parallel(Memory*     memory,
+                            const char* chars,
+                            u64         len,
+                            u16         len_workers) {
+    Bench bench = {0};
+    u64   start = get_monotonic();
+    do {
+        bench.matches = search_parallel(memory, chars, len, len_workers).match
+                            ? 1
+                            : 0;
+        bench.bytes += len;
+        ++bench.iterations;
+        bench.nanoseconds = get_monotonic() - start;
+    } while (bench.nanoseconds < BENCH_NANO);
+    return bench;
+}
+
+static Bench bench_compile(Memory* memory, String regex, Bool jit) {
+    Bench bench = {0};
+    u64   start = get_monotonic();
+    do {
+        compile(memory, regex);
+        if (jit) {
+            compile_jit(memory);
+        }
+        bench.bytes += regex.len;
+        ++bench.iterations;
+        bench.nanoseconds = get_monotonic() - start;
+    } while (bench.nanoseconds < BENCH_NANO);
+    return bench;
+}
+
+static Bench bench_cache(Memory* memory, Cache* cache, String regex) {
+    Bench bench = {0};
+    u64   start = get_monotonic();
+    do {
+        compile_cached(memory, cache, regex);
+        bench.bytes += regex.len;
+        ++bench.iterations;
+        bench.nanoseconds = get_monotonic() - start;
+    } while (bench.nanoseconds < BENCH_NANO);
+    return bench;
+}
+
+static Bench bench_load(Memory* memory, String regex) {
+    FILE* file = tmpfile();
+    EXIT_IF(!file);
+    compile(memory, regex);
+    write_program(memory, file);
+    Bench bench = {0};
+    u64   start = get_monotonic();
+    do {
+        read_program(memory, fileno(file));
+        bench.bytes += regex.len;
+        ++bench.iterations;
+        bench.nanoseconds = get_monotonic() - start;
+    } while (bench.nanoseconds < BENCH_NANO);
+    EXIT_IF(fclose(file));
+    return bench;
+}
+
+static void show_bench(const char* engine, const char* label, Bench bench) {
+    f64 seconds = (f64)bench.nanoseconds / (f64)NANO_PER_SECOND;
+    printf("%-8s %-24s %12lu %12lu %12.2f %8lu\n",
+           engine,
+           label,
+           bench.bytes / bench.iterations,
+           bench.nanoseconds / bench.iterations,
+           ((f64)bench.bytes / seconds) / (f64)(1 << 20),
+           bench.matches);
+}
+
+static Bounds search_line(Memory* memory, String string) {
+    return search_stream(memory, string.chars, string.len);
+}
+
+static const char* BENCH_ENGINES[] = {
+    "pike",
+    "dfa",
+    "auto",
+    "jit",
+    "stream",
+    "reverse",
+};
+
+static const SearchFn BENCH_SEARCH_FNS[] = {
+    search,
+    search_dfa,
+    search_auto,
+    search_jit,
+    search_line,
+    search_reverse,
+};
+
+STATIC_ASSERT(LEN_ARRAY(BENCH_ENGINES) == LEN_ARRAY(BENCH_SEARCH_FNS),
+              "LEN_ARRAY(BENCH_ENGINES) != LEN_ARRAY(BENCH_SEARCH_FNS)");
+
+static const char* BENCH_REGEXES[] = {
+    "ne+dle",
+    "(a|b)(c|d)+e",
+    "((a|b)*c|d?e)+f",
+};
+
+static const u64 BENCH_LENS[] = {
+    1lu << 12,
+    1lu << 16,
+    1lu << 20,
+};
+
+static const u32 BENCH_DENSITIES[] = {0, 8, 512};
+
+static const u16 BENCH_PATHOLOGICAL[] = {4, 8, 12, 16};
+
+static const u16 BENCH_WORKERS[] = {1, 4, 16};
+
+static void bench(void) {
+    Memory* memory = calloc(1, sizeof(Memory));
+    EXIT_IF(!memory);
+    Corpus* corpus = calloc(1, sizeof(Corpus));
+    EXIT_IF(!corpus);
+    Cache* cache = calloc(1, sizeof(Cache));
+    EXIT_IF(!cache);
+    char label[CAP_STRING];
+    printf("%-8s %-24s %12s %12s %12s %8s\n",
+           "engine",
+           "bench",
+           "bytes/iter",
+           "ns/iter",
+           "MB/s",
+           "matches");
+    for (u32 i = 0; i < LEN_ARRAY(BENCH_REGEXES); ++i) {
+        String regex = {
+            .chars = BENCH_REGEXES[i],
+            .len = (u16)strlen(BENCH_REGEXES[i]),
+        };
+        show_bench("compile",
+                   regex.chars,
+                   bench_compile(memory, regex, FALSE));
+        show_bench("jit", regex.chars, bench_compile(memory, regex, TRUE));
+        show_bench("cache", regex.chars, bench_cache(memory, cache, regex));
+        show_bench("load", regex.chars, bench_load(memory, regex));
+    }
+    compile(memory, TO_STRING("ne+dle"));
+    compile_jit(memory);
+    for (u32 i = 0; i < LEN_ARRAY(BENCH_LENS); ++i) {
+        for (u32 j = 0; j < LEN_ARRAY(BENCH_DENSITIES); ++j) {
+            set_corpus(corpus, BENCH_LENS[i], BENCH_DENSITIES[j]);
+            snprintf(label,
+                     CAP_STRING,
+                     "corpus %lu %u/1024",
+                     BENCH_LENS[i],
+                     BENCH_DENSITIES[j]);
+            for (u32 k = 0; k < LEN_ARRAY(BENCH_ENGINES); ++k) {
+                show_bench(
+                    BENCH_ENGINES[k],
+                    label,
+                    bench_corpus(memory, BENCH_SEARCH_FNS[k], corpus));
+            }
+            show_bench("all", label, bench_find_all(memory, corpus));
+        }
+    }
+    for (u32 i = 0; i < LEN_ARRAY(BENCH_PATHOLOGICAL); ++i) {
+        u16  n = BENCH_PATHOLOGICAL[i];
+        char chars[CAP_STRING];
+        EXIT_IF(CAP_STRING < (3 * n));
+        for (u16 j = 0; j < n; ++j) {
+            chars[2 * j] = 'a';
+            chars[(2 * j) + 1] = '?';
+            chars[(2 * n) + j] = 'a';
+        }
+        compile(memory,
+                (String){
+                    .chars = chars,
+                    .len = (u16)(3 * n),
+                });
+        compile_jit(memory);
+        snprintf(label, CAP_STRING, "(a?)^%hu a^%hu", n, n);
+        for (u32 k = 0; k < LEN_ARRAY(BENCH_ENGINES); ++k) {
+            show_bench(BENCH_ENGINES[k],
+                       label,
+                       bench_string(memory,
+                                    BENCH_SEARCH_FNS[k],
+                                    (String){
+                                        .chars = &chars[2 * n],
+                                        .len = n,
+                                    }));
+        }
+    }
+    {
+        u64   len = 16 * CAP_SLICE;
+        char* chars = mmap(NULL,
+                           len,
+                           PROT_READ | PROT_WRITE,
+                           MAP_ANONYMOUS | MAP_PRIVATE,
+                           -1,
+                           0);
+        EXIT_IF(chars == MAP_FAILED);
+        memset(chars, 'x', len);
+        for (u64 i = 0; i < len; i += CAP_SLICE) {
+            chars[i] = 'a';
+        }
+        compile(memory, TO_STRING("a(a|x)*b"));
+        for (u32 i = 0; i < LEN_ARRAY(BENCH_WORKERS); ++i) {
+            snprintf(label,
+                     CAP_STRING,
+                     "a(a|x)*b %lu/%hu",
+                     len,
+                     BENCH_WORKERS[i]);
+            show_bench("parallel",
+                       label,
+                       bench_parallel(memory, chars, len, BENCH_WORKERS[i]));
+        }
+        EXIT_IF(munmap(chars, len));
+    }
+    Usage usage;
+    EXIT_IF(getrusage(RUSAGE_SELF, &usage));
+    printf("\nsizeof(Memory) : %zu\n"
+           "sizeof(Corpus) : %zu\n"
+           "peak memory    : %ld KiB\n",
+           sizeof(Memory),
+           sizeof(Corpus),
+           usage.ru_maxrss);
+    if (memory->jit) {
+        EXIT_IF(munmap(memory->jit, CAP_JIT));
+    }
+    free(cache);
+    free(corpus);
+    free(memory);
+}
+
+i32 main(i32 argc, const char** argv) {
+    if ((1 < argc) && (!strcmp(argv[1], "bench"))) {
+        bench();
+        return EXIT_SUCCESS;
+    }
+    if ((2 < argc) && (!strcmp(argv[1], "lexer"))) {
+        EXIT_IF(strcmp(argv[2], "switch") && strcmp(argv[2], "table"));
+        show_lexer(argc - 3, &argv[3], !strcmp(argv[2], "table"));
+        return EXIT_SUCCESS;
+    }
+    if ((2 < argc) && (!strcmp(argv[1], "save"))) {
+        Memory* memory = calloc(1, sizeof(Memory));
+        EXIT_IF(!memory);
+        compile(memory,
+                (String){
+                    .chars = argv[2],
+                    .len = (u16)strlen(argv[2]),
+                });
+        write_program(memory, stdout);
+        free(memory);
+        return EXIT_SUCCESS;
+    }
+    printf("\n"
            "sizeof(TokenTag)   : %zu\n"
            "sizeof(Token)      : %zu\n"
            "sizeof(ExprTag)    : %zu\n"
@@ -824,6 +3806,8 @@ i32 main(void) {
            "sizeof(Thread)     : %zu\n"
            "sizeof(Threads)    : %zu\n"
            "sizeof(Bounds)     : %zu\n"
+           "sizeof(Stream)     : %zu\n"
+           "sizeof(DfaState)   : %zu\n"
            "sizeof(Memory)     : %zu\n"
            "\n",
            sizeof(TokenTag),
@@ -840,19 +3824,24 @@ i32 main(void) {
            sizeof(Thread),
            sizeof(Threads),
            sizeof(Bounds),
+           sizeof(Stream),
+           sizeof(DfaState),
            sizeof(Memory));
     Memory* memory = calloc(1, sizeof(Memory));
     EXIT_IF(!memory);
     {
         Expr* expr = compile(memory, TO_STRING("a*"));
+        compile_jit(memory);
         show_all(memory, expr);
         NO_SEARCH(memory, "");
-        SEARCH(memory, "   ", 2, 2);
+        SEARCH(memory, "   ", 0, 0);
         SEARCH(memory, "aaaaa", 0, 5);
+        SEARCH(memory, "  aa", 0, 0);
         fprintf(stderr, "\n");
     }
     {
         Expr* expr = compile(memory, TO_STRING("_*a|b+|c"));
+        compile_jit(memory);
         show_all(memory, expr);
         NO_SEARCH(memory, "");
         NO_SEARCH(memory, " ");
@@ -865,6 +3854,7 @@ i32 main(void) {
     }
     {
         Expr* expr = compile(memory, TO_STRING("fo*|(ba(r|z?))+|jazz"));
+        compile_jit(memory);
         show_all(memory, expr);
         NO_SEARCH(memory, "");
         NO_SEARCH(memory, "???");
@@ -887,6 +3877,7 @@ i32 main(void) {
     {
         compile(memory,
                 TO_STRING("a?a?a?a?a?a?a?a?a?a?a?a?a?a?aaaaaaaaaaaaaaaaaaa"));
+        compile_jit(memory);
         NO_SEARCH(memory, "aaaaaaaaaaaaaaaaaa");
         SEARCH(memory, " aaaaaaaaaaaaaaaaaaa", 1, 20);
         SEARCH(memory, " aaaaaaaaaaaaaaaaaaaaaaaaa", 1, 26);
@@ -894,6 +3885,515 @@ i32 main(void) {
         SEARCH(memory, " aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", 1, 34);
         fprintf(stderr, "\n");
     }
+    {
+        Expr* expr = compile(memory, TO_STRING("ba{3,5}"));
+        compile_jit(memory);
+        show_all(memory, expr);
+        u16 len_insts = memory->len_insts;
+        NO_SEARCH(memory, "baab");
+        SEARCH(memory, " baaa", 1, 5);
+        SEARCH(memory, "baaaaaaa", 0, 6);
+        SEARCH(memory, "bbaaab", 1, 5);
+        {
+            u16 expected[] = {0, 4, 5, 11};
+            FIND_ALL(memory, "baaa baaaaa baa", expected);
+        }
+        compile(memory, TO_STRING("ba{3,60}"));
+        EXIT_IF(memory->len_insts != len_insts);
+        SEARCH(memory,
+               " baaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+               "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+               1,
+               62);
+        compile(memory, TO_STRING("a{2,}b|a{0}c"));
+        NO_SEARCH(memory, "ab");
+        SEARCH(memory, "aaaaaab", 0, 7);
+        SEARCH(memory, "ac", 1, 2);
+        SEARCH(memory, "abaaab", 2, 6);
+        fprintf(stderr, "\n");
+    }
+    {
+        Expr* expr = compile(memory, TO_STRING("x(a|b){2,40}y"));
+        compile_jit(memory);
+        show_all(memory, expr);
+        NO_SEARCH(memory, "xay");
+        NO_SEARCH(memory, "xabcy");
+        SEARCH(memory, " xaby", 1, 5);
+        SEARCH(memory, "xabbababaay", 0, 11);
+        SEARCH(memory, "xxabbababaay", 1, 12);
+        {
+            Bounds groups[CAP_GROUPS];
+            EXIT_IF(!search_groups(memory, TO_STRING("xabaay"), groups).match);
+            GROUP(groups, 0, 4, 5);
+        }
+        compile(memory, TO_STRING("(a|b){0,3}c"));
+        SEARCH(memory, "c", 0, 1);
+        SEARCH(memory, "ababc", 1, 5);
+        {
+            Bounds groups[CAP_GROUPS];
+            EXIT_IF(!search_groups(memory, TO_STRING("c"), groups).match);
+            NO_GROUP(groups, 0);
+            EXIT_IF(!search_groups(memory, TO_STRING("bac"), groups).match);
+            GROUP(groups, 0, 1, 2);
+        }
+        compile(memory, TO_STRING("(ab){2,3}|(cd){1,}"));
+        EXIT_IF(memory->len_counters != 0);
+        NO_SEARCH(memory, "ab ab");
+        SEARCH(memory, "abababab", 0, 6);
+        SEARCH(memory, "x cdcdc", 2, 6);
+        fprintf(stderr, "\n");
+    }
+    {
+        Cache* cache = calloc(1, sizeof(Cache));
+        EXIT_IF(!cache);
+        compile_cached(memory, cache, TO_STRING("fo*|(ba(r|z?))+|jazz"));
+        compile_cached(memory, cache, TO_STRING("ba{3,5}"));
+        compile_cached(memory, cache, TO_STRING("fo*|(ba(r|z?))+|jazz"));
+        EXIT_IF((cache->len != 2) || (cache->hits != 1) ||
+                (cache->misses != 2));
+        SEARCH(memory, "  babarbazba", 2, 12);
+        SEARCH(memory, "jazzz", 0, 4);
+        compile_cached(memory, cache, TO_STRING("ba{3,5}"));
+        NO_SEARCH(memory, "baab");
+        SEARCH(memory, "bbaaab", 1, 5);
+        char chars[] = {'_', '\0'};
+        for (u16 i = 0; i < CAP_CACHE; ++i) {
+            chars[0] = (char)('a' + i);
+            compile_cached(memory,
+                           cache,
+                           (String){
+                               .chars = chars,
+                               .len = 1,
+                           });
+        }
+        EXIT_IF((cache->len != CAP_CACHE) || (cache->misses != 18));
+        compile_cached(memory, cache, TO_STRING("ba{3,5}"));
+        EXIT_IF(cache->misses != 19);
+        compile_cached(memory, cache, TO_STRING("p"));
+        EXIT_IF(cache->hits != 3);
+        SEARCH(memory, "xyzp", 3, 4);
+        FILE* file = tmpfile();
+        EXIT_IF(!file);
+        compile(memory, TO_STRING("_*a|b+|c"));
+        compile_jit(memory);
+        write_program(memory, file);
+        compile(memory, TO_STRING("ba{3,5}"));
+        read_program(memory, fileno(file));
+        compile_jit(memory);
+        NO_SEARCH(memory, " ");
+        SEARCH(memory, " __a ", 1, 4);
+        SEARCH(memory, "  bbb ", 2, 5);
+        EXIT_IF(fclose(file));
+        free(cache);
+        String regex = TO_STRING("x(a|b){2,40}y");
+        compile(memory, regex);
+        u8  bytes[CAP_PROGRAM];
+        u64 len = save_program(memory, bytes);
+        compile(memory, TO_STRING("p"));
+        EXIT_IF(len <= get_program_len(memory));
+        load_program(memory, bytes, len);
+        SEARCH(memory, "xabay", 0, 5);
+        NO_SEARCH(memory, "xay");
+        EXIT_IF(!is_program_valid(memory));
+        memory->len_literal = CAP_LITERAL + 1;
+        EXIT_IF(is_program_valid(memory));
+        compile(memory, regex);
+        memory->closures[0] |= 1lu << memory->len_insts;
+        EXIT_IF(is_program_valid(memory));
+        compile(memory, regex);
+        memory->counters[0].range.min = 64;
+        EXIT_IF(is_program_valid(memory));
+        for (u16 i = 0; i < memory->len_insts; ++i) {
+            compile(memory, regex);
+            memory->insts[i].tag = INST_JUMP;
+            memory->insts[i].op.as_line[0] = memory->len_insts;
+            EXIT_IF(is_program_valid(memory));
+        }
+        fprintf(stderr, "\n");
+    }
+    {
+        compile(memory, TO_STRING("abcd|c"));
+        SEARCH(memory, "abcd", 0, 4);
+        SEARCH(memory, "abc", 2, 3);
+        {
+            u16 expected[] = {2, 3, 3, 7, 8, 9};
+            FIND_ALL(memory, "abcabcd c", expected);
+        }
+        compile(memory, TO_STRING("ab+"));
+        {
+            u16 expected[] = {0, 2, 3, 7, 9, 11};
+            FIND_ALL(memory, "ab abbb xab", expected);
+        }
+        compile(memory, TO_STRING("a*"));
+        {
+            u16 expected[] = {0, 0, 1, 3};
+            FIND_ALL(memory, "baab", expected);
+        }
+        compile(memory, TO_STRING("a+b|a"));
+        {
+            u16 expected[] = {0, 1, 1, 2, 2, 3, 3, 4, 5, 7};
+            FIND_ALL(memory, "aaaa ab", expected);
+        }
+        compile(memory, TO_STRING("x|x(bc)*d|b"));
+        {
+            u16 expected[] = {0, 8, 9, 10, 10, 11, 12, 13};
+            FIND_ALL(memory, "xbcbcbcd xbcb", expected);
+        }
+        compile(memory, TO_STRING("ne+dle"));
+        u64   len = 1lu << 20;
+        u64   offset = len - (1lu << 10);
+        char* chars = malloc(len);
+        EXIT_IF(!chars);
+        memset(chars, 'n', len);
+        memcpy(&chars[offset], "needle", sizeof("needle") - 1);
+        Bounds result = search_stream(memory, chars, len);
+        EXIT_IF((!result.match) || (result.start != offset) ||
+                (result.end != (offset + sizeof("needle") - 1)));
+        String string = {
+            .chars = &chars[len - 0xFFFF],
+            .len = 0xFFFF,
+        };
+        result = search_reverse(memory, string);
+        EXIT_IF((!result.match) ||
+                (result.start != (offset - (len - string.len))) ||
+                (result.end != (offset - (len - string.len) + 6)));
+        free(chars);
+        fprintf(stderr, ".\n");
+    }
+    {
+        compile(memory, TO_STRING("b?b"));
+        {
+            u16 expected[] = {0, 2, 2, 3};
+            FIND_ALL(memory, "bbb", expected);
+        }
+        compile(memory, TO_STRING("(b)?b"));
+        {
+            u16 expected[] = {1, 2, 3, 5, 5, 6};
+            FIND_ALL(memory, "abxbbbxax", expected);
+        }
+        compile(memory, TO_STRING("((a|b))?a"));
+        {
+            u16 expected[] = {0, 2, 2, 3, 5, 7, 7, 9, 9, 11, 11, 12};
+            FIND_ALL(memory, "baaxbbabaaaa", expected);
+        }
+        const String regexes[] = {
+            TO_STRING("b?b"),
+            TO_STRING("((a|b))?a"),
+            TO_STRING("a*"),
+            TO_STRING("a+b|a"),
+            TO_STRING("(ab|a)(bc|c)?"),
+            TO_STRING("(a|b){0,2}b"),
+        };
+        u32 rng = BENCH_SEED;
+        for (u16 i = 0; i < LEN_ARRAY(regexes); ++i) {
+            compile(memory, regexes[i]);
+            for (u16 j = 0; j < (1 << 12); ++j) {
+                char   chars[16];
+                String string = {
+                    .chars = chars,
+                    .len = (u16)(xor_shift_32(&rng) % sizeof(chars)),
+                };
+                for (u16 k = 0; k < string.len; ++k) {
+                    chars[k] = "abc"[xor_shift_32(&rng) % 3];
+                }
+                Bounds expected[CAP_PENDING];
+                Bounds found[CAP_PENDING];
+                u16    len = find_all_rescan(memory, string, expected);
+                EXIT_IF(find_all(memory, string, found, 3) != len);
+                for (u16 k = 0; k < len; ++k) {
+                    EXIT_IF((found[k].start != expected[k].start) ||
+                            (found[k].end != expected[k].end));
+                }
+            }
+            fprintf(stderr, ".");
+        }
+        fprintf(stderr, "\n");
+    }
+    {
+        compile(memory, TO_STRING("ab+|ne+dle"));
+        u64   len = (6 * CAP_SLICE) + 7;
+        char* chars = mmap(NULL,
+                           len,
+                           PROT_READ | PROT_WRITE,
+                           MAP_ANONYMOUS | MAP_PRIVATE,
+                           -1,
+                           0);
+        EXIT_IF(chars == MAP_FAILED);
+        memset(chars, 'e', len);
+        PARALLEL(memory, chars, len, FALSE, 0, 0);
+        memcpy(&chars[(5 * CAP_SLICE) + 1], "needle", 6);
+        PARALLEL(memory,
+                 chars,
+                 len,
+                 TRUE,
+                 (5 * CAP_SLICE) + 1,
+                 (5 * CAP_SLICE) + 7);
+        chars[(3 * CAP_SLICE) - 1] = 'a';
+        memset(&chars[3 * CAP_SLICE], 'b', 5000);
+        PARALLEL(memory,
+                 chars,
+                 len,
+                 TRUE,
+                 (3 * CAP_SLICE) - 1,
+                 (3 * CAP_SLICE) + 5000);
+        memcpy(&chars[CAP_SLICE - 3], "needle", 6);
+        PARALLEL(memory, chars, len, TRUE, CAP_SLICE - 3, CAP_SLICE + 3);
+        memcpy(&chars[len - 2], "ab", 2);
+        PARALLEL(memory, chars, len, TRUE, CAP_SLICE - 3, CAP_SLICE + 3);
+        compile(memory, TO_STRING("a(a|x)*b"));
+        memset(chars, 'x', len);
+        for (u64 i = 0; i < len; i += CAP_SLICE) {
+            chars[i + 1] = 'a';
+        }
+        PARALLEL(memory, chars, len, FALSE, 0, 0);
+        chars[(4 * CAP_SLICE) + 9] = 'b';
+        PARALLEL(memory, chars, len, TRUE, 1, (4 * CAP_SLICE) + 10);
+        EXIT_IF(munmap(chars, len));
+        fprintf(stderr, "\n");
+    }
+    {
+        Expr* expr = compile(memory, TO_STRING("hello+ wor(ld|m)"));
+        compile_jit(memory);
+        show_all(memory, expr);
+        EXIT_IF((!memory->literal_prefix) || (memory->len_literal != 4) ||
+                memcmp(memory->literal, "hell", 4));
+        NO_SEARCH(memory, "hell o world, help! hello wor");
+        NO_SEARCH(memory, "                                    hell");
+        SEARCH(memory, "hell o world, help! hellooo world", 20, 33);
+        SEARCH(memory, "                                  hello worm", 34, 44);
+        fprintf(stderr, "\n");
+    }
+    {
+        Expr* expr = compile(memory, TO_STRING("(x|y)+needle"));
+        compile_jit(memory);
+        show_all(memory, expr);
+        EXIT_IF(memory->literal_prefix || (memory->len_literal != 6) ||
+                memcmp(memory->literal, "needle", 6));
+        NO_SEARCH(memory, "xyxyxneedl needle");
+        NO_SEARCH(memory, "                                   xneedl");
+        SEARCH(memory, "....xxneedle..", 4, 12);
+        SEARCH(memory, "                                   yneedle", 35, 42);
+        fprintf(stderr, "\n");
+    }
+    {
+        Expr* expr = compile(memory, TO_STRING("k(e+)y=(v(a)l|x)*;"));
+        show_all(memory, expr);
+        Bounds subs[CAP_GROUPS];
+        Bounds bounds =
+            search_groups(memory, TO_STRING("key=valxval;"), subs);
+        EXIT_IF((!bounds.match) || (bounds.start != 0) || (bounds.end != 12));
+        EXIT_IF(memory->len_groups != 3);
+        GROUP(subs, 0, 1, 2);
+        GROUP(subs, 1, 8, 11);
+        GROUP(subs, 2, 9, 10);
+        bounds = search_groups(memory, TO_STRING("  keey=xx;"), subs);
+        EXIT_IF((!bounds.match) || (bounds.start != 2) || (bounds.end != 10));
+        GROUP(subs, 0, 3, 5);
+        GROUP(subs, 1, 8, 9);
+        NO_GROUP(subs, 2);
+        bounds = search_groups(memory, TO_STRING("key=;"), subs);
+        EXIT_IF((!bounds.match) || (bounds.start != 0) || (bounds.end != 5));
+        NO_GROUP(subs, 1);
+        SEARCH(memory, "ky=; key=val;", 5, 13);
+        NO_SEARCH(memory, "key=vl;");
+        compile(memory, TO_STRING("(fo+)|(ba(r|z))"));
+        bounds = search_groups(memory, TO_STRING(" bazfoo"), subs);
+        EXIT_IF((!bounds.match) || (bounds.start != 1) || (bounds.end != 4));
+        NO_GROUP(subs, 0);
+        GROUP(subs, 1, 1, 4);
+        GROUP(subs, 2, 3, 4);
+        String regex = TO_STRING("(a)(b)(c)(d)(e)(f)(g)(h)(i)");
+        compile(memory, regex);
+        EXIT_IF(memory->len_groups != 9);
+        bounds = search_auto(memory, TO_STRING("xabcdefghi"));
+        EXIT_IF((!bounds.match) || (bounds.start != 1) || (bounds.end != 10));
+        bounds = search_chunks(memory, TO_STRING("xabcdefghi"), 4);
+        EXIT_IF((!bounds.match) || (bounds.start != 1) || (bounds.end != 10));
+        EXIT_IF(search(memory, TO_STRING("abcdefgh")).match);
+        compile_set(memory, &regex, 1);
+        EXIT_IF(search_set(memory, TO_STRING("xabcdefghi")) != 1);
+        fprintf(stderr, "\n");
+    }
+    {
+        String regexes[] = {
+            TO_STRING("fo+"),
+            TO_STRING("ba(r|z)"),
+            TO_STRING("a*"),
+            TO_STRING("(x|y)z"),
+            TO_STRING("bar"),
+        };
+        u16 len = sizeof(regexes) / sizeof(regexes[0]);
+        compile_set(memory, regexes, len);
+        show_all(memory, NULL);
+        SEARCH_SET(memory, "", 0);
+        SEARCH_SET(memory, " ", 0x4);
+        SEARCH_SET(memory, "f baz", 0x6);
+        SEARCH_SET(memory, "bar yz", 0x1E);
+        SEARCH_SET(memory, "foo bar yz", 0x1F);
+        SEARCH_SET(memory, "xxbaxz", 0xC);
+        SEARCH(memory, "  bar", 0, 0);
+        memory->budget_dfa_states = 2;
+        compile_set(memory, regexes, len);
+        SEARCH_SET(memory, "foo bar yz", 0x1F);
+        SEARCH_SET(memory, "xxbaxz", 0xC);
+        memory->budget_dfa_states = 0;
+        fprintf(stderr, "\n");
+    }
+    {
+        String regexes[] = {
+            TO_STRING("a{2,3}"),
+            TO_STRING("xb{2,}y"),
+            TO_STRING("(c|d){3}"),
+        };
+        compile_set(memory, regexes, 3);
+        EXIT_IF(memory->len_counters != 0);
+        SEARCH_SET(memory, "a", 0);
+        SEARCH_SET(memory, "aa", 0x1);
+        SEARCH_SET(memory, "xby cd", 0);
+        SEARCH_SET(memory, "xbbby cdc", 0x6);
+        SEARCH_SET(memory, "dddd xbbbbbbby aaaa", 0x7);
+        fprintf(stderr, "\n");
+    }
+    {
+        memory->budget_dfa_states = 2;
+        compile(memory, TO_STRING("ab+c"));
+        NO_SEARCH(memory, "abab");
+        SEARCH(memory, " abbbc", 1, 6);
+        SEARCH(memory, "aabc", 1, 4);
+        EXIT_IF(search_dfa(memory, TO_STRING("abbabbxabbbbbbab")).match);
+        EXIT_IF((memory->len_dfa_states != 2) ||
+                (memory->dfa_states[0].insts != memory->closures[0]));
+        memory->budget_dfa_states = 0;
+        compile(memory, TO_STRING("ab+c"));
+        String string = TO_STRING("abbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"
+                                  "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb");
+        EXIT_IF(string.len < CAP_STRING);
+        EXIT_IF(search_dfa(memory, string).match);
+        EXIT_IF(memory->engine != ENGINE_GLUSHKOV);
+        EXIT_IF(search_glushkov(memory, string).match);
+        compile_jit(memory);
+        EXIT_IF(memory->len_jit == 0);
+        EXIT_IF(search_jit(memory, string).match);
+        EXIT_IF((memory->len_dfa_states == 0) ||
+                (CAP_DFA <= memory->len_dfa_states));
+        fprintf(stderr, ".\n");
+    }
+    {
+        char chars[200];
+        memset(chars, 'x', sizeof(chars));
+        memcpy(&chars[150], "abbc", 4);
+        String         string = {.chars = chars, .len = sizeof(chars)};
+        const SearchFn search_fns[] = {
+            search_dfa,
+            search_glushkov,
+            search_auto,
+            search_jit,
+        };
+        const String   regexes[] = {TO_STRING("ab+c"), TO_STRING("ab{1,3}c")};
+        for (u16 i = 0; i < LEN_ARRAY(regexes); ++i) {
+            compile(memory, regexes[i]);
+            compile_jit(memory);
+            for (u16 j = 0; j < LEN_ARRAY(search_fns); ++j) {
+                if ((search_fns[j] == search_glushkov) &&
+                    (memory->engine != ENGINE_GLUSHKOV))
+                {
+                    continue;
+                }
+                Bounds result = search_fns[j](memory, string);
+                EXIT_IF((!result.match) || (result.start != 150) ||
+                        (result.end != 154));
+                fprintf(stderr, ".");
+            }
+        }
+        compile(memory, TO_STRING("x*abb*c"));
+        EXIT_IF(memory->engine != ENGINE_GLUSHKOV);
+        Bounds result = search_glushkov(memory, string);
+        EXIT_IF((!result.match) || (result.start != 0) ||
+                (result.end != 154));
+        fprintf(stderr, "\n");
+    }
+    {
+        char chars[200];
+        u32  state = BENCH_SEED;
+        for (u16 i = 0; i < sizeof(chars); ++i) {
+            chars[i] = "abx"[xor_shift_32(&state) % 3];
+        }
+        const SearchFn search_fns[] = {
+            search_dfa,
+            search_auto,
+            search_jit,
+        };
+        const String regexes[] = {
+            TO_STRING("a*"),
+            TO_STRING("(ab)*"),
+            TO_STRING("a?b?"),
+            TO_STRING("(a|b){0,2}"),
+        };
+        for (u16 i = 0; i < LEN_ARRAY(regexes); ++i) {
+            compile(memory, regexes[i]);
+            compile_jit(memory);
+            for (u16 len = 1; len <= sizeof(chars); ++len) {
+                String string = {.chars = chars, .len = len};
+                Bounds expected = search_stream(memory, chars, len);
+                EXIT_IF((!expected.match) || (expected.start != 0));
+                for (u16 j = 0; j < LEN_ARRAY(search_fns); ++j) {
+                    Bounds result = search_fns[j](memory, string);
+                    EXIT_IF((!result.match) ||
+                            (result.start != expected.start) ||
+                            (result.end != expected.end));
+                }
+                if (len < CAP_STRING) {
+                    Bounds result = search(memory, string);
+                    EXIT_IF((!result.match) ||
+                            (result.start != expected.start) ||
+                            (result.end != expected.end));
+                }
+            }
+            fprintf(stderr, ".");
+        }
+        fprintf(stderr, "\n");
+    }
+    {
+        Lexer* lexer = calloc(1, sizeof(Lexer));
+        EXIT_IF(!lexer);
+        String rules[] = {
+            TO_STRING("if"),
+            TO_STRING("i(f|n)*"),
+            TO_STRING(" +"),
+            TO_STRING("(a|b)*abb"),
+        };
+        set_lexer(memory, lexer, rules, 4);
+        LEX(lexer, "if", 2, 0);
+        LEX(lexer, "iff", 3, 1);
+        LEX(lexer, "in if", 2, 1);
+        LEX(lexer, "i", 1, 1);
+        LEX(lexer, "   x", 3, 2);
+        LEX(lexer, "babbab", 4, 3);
+        LEX(lexer, "x", 0, RULE_NONE);
+        LEX(lexer, "", 0, RULE_NONE);
+        LEX(lexer, "ab", 0, RULE_NONE);
+        set_lexer(memory, lexer, &rules[3], 1);
+        EXIT_IF(lexer->len_states != 5);
+        EXIT_IF(lexer->len_classes != 3);
+        LEX(lexer, "aabbabb", 7, 0);
+        LEX(lexer, "aabbab", 4, 0);
+        String counted[] = {
+            TO_STRING("a{2,3}"),
+            TO_STRING("a"),
+            TO_STRING("b{2,}"),
+        };
+        set_lexer(memory, lexer, counted, 3);
+        LEX(lexer, "aaaa", 3, 0);
+        LEX(lexer, "aa", 2, 0);
+        LEX(lexer, "abb", 1, 1);
+        LEX(lexer, "bbbx", 3, 2);
+        LEX(lexer, "b", 0, RULE_NONE);
+        free(lexer);
+        fprintf(stderr, "\n");
+    }
+    if (memory->jit) {
+        EXIT_IF(munmap(memory->jit, CAP_JIT));
+    }
     free(memory);
     printf("\nDone!\n");
     return EXIT_SUCCESS;